@@ -102,6 +102,11 @@ extern "C"{
 #define clockCyclesToMicroseconds(a) ( (a) / clockCyclesPerMicrosecond() )
 #define microsecondsToClockCycles(a) ( (a) * clockCyclesPerMicrosecond() )
 
+// timer 0 ticks (see timerTicks), 4us at 16MHz
+#define TICK_CYCLES 64
+#define ticksToMicroseconds(t) ( (t) * (unsigned long)TICK_CYCLES / clockCyclesPerMicrosecond() )
+#define microsecondsToTicks(us) ( (us) * (unsigned long)clockCyclesPerMicrosecond() / TICK_CYCLES )
+
 #define lowByte(w) ((uint8_t) ((w) & 0xff))
 #define highByte(w) ((uint8_t) ((w) >> 8))
 
@@ -129,6 +134,8 @@ void analogWrite(uint8_t, int);
 
 unsigned long millis(void);
 unsigned long micros(void);
+uint16_t timerTicks(void);   // raw timer 0 ticks, wraps every 65536 ticks
+uint64_t timerTicks64(void); // ticks since startup, never wraps
 void delay(unsigned long);
 void delayMicroseconds(unsigned int us);
 unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout);
@@ -138,6 +145,24 @@ uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
 
 void attachInterrupt(uint8_t, void (*)(void), int mode);
 void detachInterrupt(uint8_t);
+// expander INT lines: set a flag in the handler, refresh the virtual ports from loop() or a task
+uint8_t attachPinChangeInterrupt(uint8_t pin, void (*)(void), int mode); // 0 if the pin has no pin change interrupt
+void detachPinChangeInterrupt(uint8_t pin);
+
+// cooperative tasks, run by the core between calls to loop() and while
+// delay() waits. times are in microseconds (up to 35 minutes)
+typedef struct {
+	unsigned long runs;
+	unsigned long busy;   // time spent running
+	unsigned int longest; // longest run (saturates at 65535)
+	unsigned int latest;  // longest wait past the deadline (saturates)
+} task_stats;
+
+int8_t taskEvery(void (*)(void), unsigned long interval); // returns the task id, -1 if the table is full
+int8_t taskAfter(void (*)(void), unsigned long delay);    // runs once
+void taskStop(int8_t id);
+uint8_t taskStats(int8_t id, task_stats *stats);         // 0 if the task is not scheduled
+void taskIdleSleep(uint8_t enable); // sleep after loop() until the next interrupt when no task is due
 
 void setup(void);
 void loop(void);
@@ -163,9 +188,16 @@ extern const uint8_t PROGMEM digital_pin_to_timer_PGM[];
 // 
 // These perform slightly better as macros compared to inline functions
 //
+#ifdef USE_VIRTUAL_PINS
+// the tables end after the VPINS_PORTS virtual ports, pins past them (NOT_A_VPIN) have no port
+#define digitalPinToPort(P) ( (uint8_t)(P) < NUM_MAPPED_PINS ? pgm_read_byte( digital_pin_to_port_PGM + (P) ) : NOT_A_PORT )
+#define digitalPinToBitMask(P) ( (uint8_t)(P) < NUM_MAPPED_PINS ? pgm_read_byte( digital_pin_to_bit_mask_PGM + (P) ) : 0 )
+#define digitalPinToTimer(P) ( (uint8_t)(P) < NUM_MAPPED_PINS ? pgm_read_byte( digital_pin_to_timer_PGM + (P) ) : NOT_ON_TIMER )
+#else
 #define digitalPinToPort(P) ( pgm_read_byte( digital_pin_to_port_PGM + (P) ) )
 #define digitalPinToBitMask(P) ( pgm_read_byte( digital_pin_to_bit_mask_PGM + (P) ) )
 #define digitalPinToTimer(P) ( pgm_read_byte( digital_pin_to_timer_PGM + (P) ) )
+#endif
 #define analogInPinToBit(P) (P)
 #define portOutputRegister(P) ( (volatile uint8_t *)( pgm_read_word( port_to_output_PGM + (P))) )
 #define portInputRegister(P) ( (volatile uint8_t *)( pgm_read_word( port_to_input_PGM + (P))) )
@@ -224,8 +256,11 @@ uint16_t makeWord(byte h, byte l);
 
 unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000L);
 
-void tone(uint8_t _pin, unsigned int frequency, unsigned long duration = 0);
+unsigned int tone(uint8_t _pin, unsigned int frequency, unsigned long duration = 0);
+unsigned int toneMaxFrequency(uint8_t _pin);
 void noTone(uint8_t _pin);
+uint8_t toneTimerAttach(void (*)(void)); // the tone timer interrupt for other libraries, 0 while a tone plays
+void toneTimerDetach(void);
 
 // WMath prototypes
 long random(long);
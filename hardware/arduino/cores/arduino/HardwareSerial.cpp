@@ -48,48 +48,103 @@
 #error TXC0 not definable in HardwareSerial.h
 #endif
 #endif
+#if !defined(UDRE0)
+#if defined(UDRE)
+#define UDRE0 UDRE
+#elif defined(UDRE1)
+#define UDRE0 UDRE1
+#else
+#error UDRE0 not definable in HardwareSerial.h
+#endif
+#endif
 
 // Define constants and variables for buffering incoming serial data.  We're
 // using a ring buffer (I think), in which head is the index of the location
 // to which to write the next incoming character and tail is the index of the
 // location from which to read.
+// Sizes can be set per port and direction at compile time (e.g.
+// -DSERIAL0_RX_BUFFER_SIZE=256), they must be powers of two up to 256 so the
+// 8 bit indices wrap with a mask. One slot is kept free to tell full from empty.
 #if (RAMEND < 1000)
   #define SERIAL_BUFFER_SIZE 16
 #else
   #define SERIAL_BUFFER_SIZE 64
 #endif
+#if !defined(SERIAL_RX_BUFFER_SIZE)
+  #define SERIAL_RX_BUFFER_SIZE SERIAL_BUFFER_SIZE
+#endif
+#if !defined(SERIAL_TX_BUFFER_SIZE)
+  #define SERIAL_TX_BUFFER_SIZE SERIAL_BUFFER_SIZE
+#endif
+#if !defined(SERIAL0_RX_BUFFER_SIZE)
+  #define SERIAL0_RX_BUFFER_SIZE SERIAL_RX_BUFFER_SIZE
+#endif
+#if !defined(SERIAL0_TX_BUFFER_SIZE)
+  #define SERIAL0_TX_BUFFER_SIZE SERIAL_TX_BUFFER_SIZE
+#endif
+#if !defined(SERIAL1_RX_BUFFER_SIZE)
+  #define SERIAL1_RX_BUFFER_SIZE SERIAL_RX_BUFFER_SIZE
+#endif
+#if !defined(SERIAL1_TX_BUFFER_SIZE)
+  #define SERIAL1_TX_BUFFER_SIZE SERIAL_TX_BUFFER_SIZE
+#endif
+#if !defined(SERIAL2_RX_BUFFER_SIZE)
+  #define SERIAL2_RX_BUFFER_SIZE SERIAL_RX_BUFFER_SIZE
+#endif
+#if !defined(SERIAL2_TX_BUFFER_SIZE)
+  #define SERIAL2_TX_BUFFER_SIZE SERIAL_TX_BUFFER_SIZE
+#endif
+#if !defined(SERIAL3_RX_BUFFER_SIZE)
+  #define SERIAL3_RX_BUFFER_SIZE SERIAL_RX_BUFFER_SIZE
+#endif
+#if !defined(SERIAL3_TX_BUFFER_SIZE)
+  #define SERIAL3_TX_BUFFER_SIZE SERIAL_TX_BUFFER_SIZE
+#endif
 
-struct ring_buffer
+#define SERIAL_SIZE_OK(s) ((s) >= 2 && (s) <= 256 && ((s) & ((s) - 1)) == 0)
+#if !SERIAL_SIZE_OK(SERIAL0_RX_BUFFER_SIZE) || !SERIAL_SIZE_OK(SERIAL0_TX_BUFFER_SIZE) || \
+    !SERIAL_SIZE_OK(SERIAL1_RX_BUFFER_SIZE) || !SERIAL_SIZE_OK(SERIAL1_TX_BUFFER_SIZE) || \
+    !SERIAL_SIZE_OK(SERIAL2_RX_BUFFER_SIZE) || !SERIAL_SIZE_OK(SERIAL2_TX_BUFFER_SIZE) || \
+    !SERIAL_SIZE_OK(SERIAL3_RX_BUFFER_SIZE) || !SERIAL_SIZE_OK(SERIAL3_TX_BUFFER_SIZE)
+  #error serial buffer sizes must be powers of two from 2 to 256
+#endif
+
+struct serial_ring_buffer
 {
-  unsigned char buffer[SERIAL_BUFFER_SIZE];
-  volatile unsigned int head;
-  volatile unsigned int tail;
+  unsigned char *buffer;
+  uint8_t mask; // size - 1
+  volatile uint8_t head;
+  volatile uint8_t tail;
 };
 
+#define RING_BUFFER(name, size) \
+  static unsigned char name##_data[size]; \
+  serial_ring_buffer name = { name##_data, (size) - 1, 0, 0 }
+
 #if defined(USBCON)
-  ring_buffer rx_buffer = { { 0 }, 0, 0};
-  ring_buffer tx_buffer = { { 0 }, 0, 0};
+  RING_BUFFER(rx_buffer, SERIAL0_RX_BUFFER_SIZE);
+  RING_BUFFER(tx_buffer, SERIAL0_TX_BUFFER_SIZE);
 #endif
 #if defined(UBRRH) || defined(UBRR0H)
-  ring_buffer rx_buffer  =  { { 0 }, 0, 0 };
-  ring_buffer tx_buffer  =  { { 0 }, 0, 0 };
+  RING_BUFFER(rx_buffer, SERIAL0_RX_BUFFER_SIZE);
+  RING_BUFFER(tx_buffer, SERIAL0_TX_BUFFER_SIZE);
 #endif
 #if defined(UBRR1H)
-  ring_buffer rx_buffer1  =  { { 0 }, 0, 0 };
-  ring_buffer tx_buffer1  =  { { 0 }, 0, 0 };
+  RING_BUFFER(rx_buffer1, SERIAL1_RX_BUFFER_SIZE);
+  RING_BUFFER(tx_buffer1, SERIAL1_TX_BUFFER_SIZE);
 #endif
 #if defined(UBRR2H)
-  ring_buffer rx_buffer2  =  { { 0 }, 0, 0 };
-  ring_buffer tx_buffer2  =  { { 0 }, 0, 0 };
+  RING_BUFFER(rx_buffer2, SERIAL2_RX_BUFFER_SIZE);
+  RING_BUFFER(tx_buffer2, SERIAL2_TX_BUFFER_SIZE);
 #endif
 #if defined(UBRR3H)
-  ring_buffer rx_buffer3  =  { { 0 }, 0, 0 };
-  ring_buffer tx_buffer3  =  { { 0 }, 0, 0 };
+  RING_BUFFER(rx_buffer3, SERIAL3_RX_BUFFER_SIZE);
+  RING_BUFFER(tx_buffer3, SERIAL3_TX_BUFFER_SIZE);
 #endif
 
-inline void store_char(unsigned char c, ring_buffer *buffer)
+inline void store_char(unsigned char c, serial_ring_buffer *buffer)
 {
-  int i = (unsigned int)(buffer->head + 1) % SERIAL_BUFFER_SIZE;
+  uint8_t i = (buffer->head + 1) & buffer->mask;
 
   // if we should be storing the received character into the location
   // just before the tail (meaning that the head would advance to the
@@ -229,7 +284,7 @@ ISR(USART_UDRE_vect)
   else {
     // There is more data in the output buffer. Send the next byte
     unsigned char c = tx_buffer.buffer[tx_buffer.tail];
-    tx_buffer.tail = (tx_buffer.tail + 1) % SERIAL_BUFFER_SIZE;
+    tx_buffer.tail = (tx_buffer.tail + 1) & tx_buffer.mask;
 	
   #if defined(UDR0)
     UDR0 = c;
@@ -253,7 +308,7 @@ ISR(USART1_UDRE_vect)
   else {
     // There is more data in the output buffer. Send the next byte
     unsigned char c = tx_buffer1.buffer[tx_buffer1.tail];
-    tx_buffer1.tail = (tx_buffer1.tail + 1) % SERIAL_BUFFER_SIZE;
+    tx_buffer1.tail = (tx_buffer1.tail + 1) & tx_buffer1.mask;
 	
     UDR1 = c;
   }
@@ -270,7 +325,7 @@ ISR(USART2_UDRE_vect)
   else {
     // There is more data in the output buffer. Send the next byte
     unsigned char c = tx_buffer2.buffer[tx_buffer2.tail];
-    tx_buffer2.tail = (tx_buffer2.tail + 1) % SERIAL_BUFFER_SIZE;
+    tx_buffer2.tail = (tx_buffer2.tail + 1) & tx_buffer2.mask;
 	
     UDR2 = c;
   }
@@ -287,7 +342,7 @@ ISR(USART3_UDRE_vect)
   else {
     // There is more data in the output buffer. Send the next byte
     unsigned char c = tx_buffer3.buffer[tx_buffer3.tail];
-    tx_buffer3.tail = (tx_buffer3.tail + 1) % SERIAL_BUFFER_SIZE;
+    tx_buffer3.tail = (tx_buffer3.tail + 1) & tx_buffer3.mask;
 	
     UDR3 = c;
   }
@@ -297,7 +352,7 @@ ISR(USART3_UDRE_vect)
 
 // Constructors ////////////////////////////////////////////////////////////////
 
-HardwareSerial::HardwareSerial(ring_buffer *rx_buffer, ring_buffer *tx_buffer,
+HardwareSerial::HardwareSerial(serial_ring_buffer *rx_buffer, serial_ring_buffer *tx_buffer,
   volatile uint8_t *ubrrh, volatile uint8_t *ubrrl,
   volatile uint8_t *ucsra, volatile uint8_t *ucsrb,
   volatile uint8_t *ucsrc, volatile uint8_t *udr,
@@ -316,6 +371,7 @@ HardwareSerial::HardwareSerial(ring_buffer *rx_buffer, ring_buffer *tx_buffer,
   _rxcie = rxcie;
   _udrie = udrie;
   _u2x = u2x;
+  _block_write = true;
 }
 
 // Public Methods //////////////////////////////////////////////////////////////
@@ -426,7 +482,12 @@ void HardwareSerial::end()
 
 int HardwareSerial::available(void)
 {
-  return (unsigned int)(SERIAL_BUFFER_SIZE + _rx_buffer->head - _rx_buffer->tail) % SERIAL_BUFFER_SIZE;
+  return (uint8_t)(_rx_buffer->head - _rx_buffer->tail) & _rx_buffer->mask;
+}
+
+int HardwareSerial::availableForWrite(void)
+{
+  return (uint8_t)(_tx_buffer->tail - _tx_buffer->head - 1) & _tx_buffer->mask;
 }
 
 int HardwareSerial::peek(void)
@@ -445,11 +506,33 @@ int HardwareSerial::read(void)
     return -1;
   } else {
     unsigned char c = _rx_buffer->buffer[_rx_buffer->tail];
-    _rx_buffer->tail = (unsigned int)(_rx_buffer->tail + 1) % SERIAL_BUFFER_SIZE;
+    _rx_buffer->tail = (_rx_buffer->tail + 1) & _rx_buffer->mask;
     return c;
   }
 }
 
+const uint8_t *HardwareSerial::peekBuffer(size_t &length)
+{
+  uint8_t head = _rx_buffer->head;
+  uint8_t tail = _rx_buffer->tail;
+
+  // up to the head, or to the end of the ring when the data wraps around
+  if (head >= tail)
+    length = head - tail;
+  else
+    length = (size_t)_rx_buffer->mask + 1 - tail;
+  return _rx_buffer->buffer + tail;
+}
+
+void HardwareSerial::consume(size_t count)
+{
+  uint8_t used = available();
+
+  if (count > used)
+    count = used;
+  _rx_buffer->tail = (_rx_buffer->tail + count) & _rx_buffer->mask;
+}
+
 void HardwareSerial::flush()
 {
   // UDR is kept full while the buffer is not empty, so TXC triggers when EMPTY && SENT
@@ -457,15 +540,32 @@ void HardwareSerial::flush()
   transmitting = false;
 }
 
+// nothing queued and the data register free: the byte goes straight to UDR
+bool HardwareSerial::writeDirect(uint8_t c)
+{
+  if (_tx_buffer->head != _tx_buffer->tail || !(*_ucsra & _BV(UDRE0)))
+    return false;
+  uint8_t oldSREG = SREG;
+  cli();
+  *_udr = c;
+  // clear the TXC bit -- "can be cleared by writing a one to its bit location"
+  sbi(*_ucsra, TXC0);
+  SREG = oldSREG;
+  transmitting = true;
+  return true;
+}
+
 size_t HardwareSerial::write(uint8_t c)
 {
-  int i = (_tx_buffer->head + 1) % SERIAL_BUFFER_SIZE;
+  if (writeDirect(c)) return 1;
+
+  uint8_t i = (_tx_buffer->head + 1) & _tx_buffer->mask;
 	
   // If the output buffer is full, there's nothing for it other than to 
-  // wait for the interrupt handler to empty it a bit
-  // ???: return 0 here instead?
+  // wait for the interrupt handler to empty it a bit, or to give up when
+  // writes don't block
   while (i == _tx_buffer->tail)
-    ;
+    if (!_block_write) return 0;
 	
   _tx_buffer->buffer[_tx_buffer->head] = c;
   _tx_buffer->head = i;
@@ -478,6 +578,39 @@ size_t HardwareSerial::write(uint8_t c)
   return 1;
 }
 
+// runs are copied into the TX ring and the interrupt is enabled once per run
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  if (size && writeDirect(*buffer)) n++;
+
+  while (n < size) {
+    uint8_t head = _tx_buffer->head;
+    uint8_t room = (uint8_t)(_tx_buffer->tail - head - 1) & _tx_buffer->mask;
+    if (room == 0) {
+      // full: the interrupt is already on and makes room
+      if (!_block_write) break;
+      continue;
+    }
+    // up to the free space, the end of the data or the end of the ring
+    uint8_t run = _tx_buffer->mask - head + 1 > room ? room : _tx_buffer->mask - head + 1;
+    if (run > size - n) run = size - n;
+    memcpy(_tx_buffer->buffer + head, buffer + n, run);
+    _tx_buffer->head = (head + run) & _tx_buffer->mask;
+    n += run;
+
+    sbi(*_ucsrb, _udrie);
+    transmitting = true;
+    sbi(*_ucsra, TXC0);
+  }
+  return n;
+}
+
+void HardwareSerial::setWriteBlocking(bool block)
+{
+  _block_write = block;
+}
+
 HardwareSerial::operator bool() {
 	return true;
 }
@@ -27,13 +27,13 @@
 
 #include "Stream.h"
 
-struct ring_buffer;
+struct serial_ring_buffer;
 
 class HardwareSerial : public Stream
 {
   private:
-    ring_buffer *_rx_buffer;
-    ring_buffer *_tx_buffer;
+    serial_ring_buffer *_rx_buffer;
+    serial_ring_buffer *_tx_buffer;
     volatile uint8_t *_ubrrh;
     volatile uint8_t *_ubrrl;
     volatile uint8_t *_ucsra;
@@ -46,8 +46,10 @@ class HardwareSerial : public Stream
     uint8_t _udrie;
     uint8_t _u2x;
     bool transmitting;
+    bool _block_write;
+    bool writeDirect(uint8_t);
   public:
-    HardwareSerial(ring_buffer *rx_buffer, ring_buffer *tx_buffer,
+    HardwareSerial(serial_ring_buffer *rx_buffer, serial_ring_buffer *tx_buffer,
       volatile uint8_t *ubrrh, volatile uint8_t *ubrrl,
       volatile uint8_t *ucsra, volatile uint8_t *ucsrb,
       volatile uint8_t *ucsrc, volatile uint8_t *udr,
@@ -59,7 +61,12 @@ class HardwareSerial : public Stream
     virtual int peek(void);
     virtual int read(void);
     virtual void flush(void);
+    virtual const uint8_t *peekBuffer(size_t &length); // received bytes, in the RX ring
+    virtual void consume(size_t count);
+    int availableForWrite(void);
+    void setWriteBlocking(bool); // false: write() returns 0 when the TX buffer is full
     virtual size_t write(uint8_t);
+    virtual size_t write(const uint8_t *buffer, size_t size);
     inline size_t write(unsigned long n) { return write((uint8_t)n); }
     inline size_t write(long n) { return write((uint8_t)n); }
     inline size_t write(unsigned int n) { return write((uint8_t)n); }
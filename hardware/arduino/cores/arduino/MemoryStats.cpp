@@ -0,0 +1,112 @@
+/*
+  MemoryStats.cpp - heap and stack usage of the running sketch
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+#include "MemoryStats.h"
+
+extern "C" {
+#include "avr-libc/stdlib_private.h"
+extern char __data_start;
+}
+
+#define MEMORY_PAINT 0xC5
+
+// Fills the RAM from the start of the heap to the top of the stack.  It runs
+// in .init3, once the stack pointer is set and before the globals are
+// initialized, and must not use the stack itself.
+extern "C" void memoryPaint(void) __attribute__((naked, used, section(".init3")));
+
+void memoryPaint(void)
+{
+  __asm__ __volatile__ (
+    "ldi r30, lo8(__heap_start)\n\t"
+    "ldi r31, hi8(__heap_start)\n\t"
+    "ldi r24, %0\n\t"
+    "ldi r25, hi8(__stack)\n\t"
+    "rjmp 2f\n"
+    "1:\n\t"
+    "st Z+, r24\n"
+    "2:\n\t"
+    "cpi r30, lo8(__stack)\n\t"
+    "cpc r31, r25\n\t"
+    "brlo 1b\n\t"
+    "breq 1b\n\t"
+    :: "M" (MEMORY_PAINT));
+}
+
+void MemoryStats::update()
+{
+  char *heapStart = __malloc_heap_start;
+  char *brk, *peak, *top, *p;
+  size_t largest = 0;
+  uint8_t oldSREG = SREG;
+
+  // the free list and the counters are copied with interrupts off, in case
+  // an interrupt handler allocates
+  cli();
+  brk = __brkval ? __brkval : heapStart;
+  peak = __brkval_peak > brk ? __brkval_peak : brk;
+  allocations = __malloc_count;
+  failures = __malloc_fails;
+  releases = __free_count;
+  heapFree = 0;
+  freeBlocks = 0;
+  for (struct __freelist *fp = __flp; fp; fp = fp->nx) {
+    heapFree += fp->sz;
+    if (freeBlocks < 255) freeBlocks++;
+    if (fp->sz > largest) largest = fp->sz;
+  }
+  SREG = oldSREG;
+
+  p = (char *)SP;
+  dataSize = &__heap_start - &__data_start;
+  heapSize = brk - heapStart;
+  heapPeak = peak - heapStart;
+  stackSize = (char *)RAMEND - p;
+  freeRam = p > brk ? p - brk : 0;
+
+  // malloc() can also extend the heap, up to __malloc_margin below the stack
+  top = __malloc_heap_end ? __malloc_heap_end : p - __malloc_margin;
+  if (top > brk + sizeof(size_t) && (size_t)(top - brk - sizeof(size_t)) > largest)
+    largest = top - brk - sizeof(size_t);
+  largestFree = largest;
+
+  // the paint is left only where neither the heap nor the stack ever were
+  top = p + 1;  // lowest byte of the stack
+  p = peak;
+  while (p < top && *(uint8_t *)p == MEMORY_PAINT) p++;
+  headroom = p - peak;
+  stackPeak = (char *)RAMEND + 1 - p;
+}
+
+uint8_t MemoryStats::fragmentation() const
+{
+  size_t total = heapFree + freeRam;
+
+  if (total == 0 || largestFree >= total) return 0;
+  return 100 - (uint8_t)((unsigned long)largestFree * 100 / total);
+}
+
+size_t MemoryStats::printTo(Print& p) const
+{
+  size_t n = p.printf(F("data %u, heap %u (peak %u, %u free in %u blocks), largest block %u, %u%% fragmented\r\n"),
+    dataSize, heapSize, heapPeak, heapFree, freeBlocks, largestFree, fragmentation());
+  n += p.printf(F("stack %u (peak %u), never used %u\r\n"), stackSize, stackPeak, headroom);
+  n += p.printf(F("malloc %lu (%lu failed), free %lu"), allocations, failures, releases);
+  return n;
+}
@@ -0,0 +1,57 @@
+/*
+  MemoryStats.h - heap and stack usage of the running sketch
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MemoryStats_h
+#define MemoryStats_h
+
+#include <inttypes.h>
+#include <stddef.h>
+#include "Printable.h"
+
+// Using any of this links in a startup routine that fills the free RAM
+// between the heap and the stack with a known pattern, so the deepest point
+// the stack ever reached can be found later.  Sketches that do not use it
+// pay nothing but the malloc() counters.
+//
+//   MemoryStats mem;    // snapshot, mem.update() takes a new one
+//   Serial.println(mem);
+
+class MemoryStats : public Printable
+{
+  public:
+    size_t dataSize;           // .data and .bss (globals)
+    size_t heapSize;           // heap in use, including the free list
+    size_t heapPeak;           // largest heapSize so far
+    size_t heapFree;           // bytes in the free list
+    uint8_t freeBlocks;        // chunks on the free list (saturates at 255)
+    size_t largestFree;        // largest malloc() that can succeed now
+    size_t freeRam;            // bytes between the top of the heap and the stack
+    size_t stackSize;          // stack in use
+    size_t stackPeak;          // deepest stack so far (painted bytes overwritten)
+    size_t headroom;           // bytes between the heap peak and the stack peak, never touched
+    unsigned long allocations; // malloc() calls, also those made by realloc(), new and String
+    unsigned long failures;    // malloc() calls that returned NULL
+    unsigned long releases;    // free() calls
+
+    MemoryStats() { update(); }
+    void update();
+    uint8_t fragmentation() const; // percent of the free memory not in the largest block
+    virtual size_t printTo(Print& p) const;
+};
+
+#endif
@@ -39,25 +39,28 @@ size_t Print::write(const uint8_t *buffer, size_t size)
   return n;
 }
 
+// flash strings go out in small RAM chunks, so bulk writers get whole runs
+#define PRINT_FLASH_CHUNK 16
+
 size_t Print::print(const __FlashStringHelper *ifsh)
 {
   const char PROGMEM *p = (const char PROGMEM *)ifsh;
+  uint8_t buf[PRINT_FLASH_CHUNK];
   size_t n = 0;
   while (1) {
-    unsigned char c = pgm_read_byte(p++);
-    if (c == 0) break;
-    n += write(c);
+    uint8_t len = 0;
+    unsigned char c;
+    while (len < PRINT_FLASH_CHUNK && (c = pgm_read_byte(p++)) != 0)
+      buf[len++] = c;
+    if (len) n += write(buf, len);
+    if (len < PRINT_FLASH_CHUNK) break;
   }
   return n;
 }
 
 size_t Print::print(const String &s)
 {
-  size_t n = 0;
-  for (uint16_t i = 0; i < s.length(); i++) {
-    n += write(s[i]);
-  }
-  return n;
+  return write(s.c_str(), s.length());
 }
 
 size_t Print::print(const char str[])
@@ -90,12 +93,11 @@ size_t Print::print(long n, int base)
   if (base == 0) {
     return write(n);
   } else if (base == 10) {
-    if (n < 0) {
-      int t = print('-');
-      n = -n;
-      return printNumber(n, 10) + t;
-    }
-    return printNumber(n, 10);
+    char buf[11]; // sign and 10 digits
+    char *end = buf + sizeof(buf);
+    char *str = formatNumber(end, n < 0 ? -(unsigned long)n : n, 10);
+    if (n < 0) *--str = '-';
+    return write(str, end - str);
   } else {
     return printNumber(n, base);
   }
@@ -112,6 +114,191 @@ size_t Print::print(double n, int digits)
   return printFloat(n, digits);
 }
 
+// value / 10^decimals, integer math only: printFixed(-1205, 2) prints -12.05
+size_t Print::printFixed(long value, uint8_t decimals)
+{
+  char buf[13]; // sign, 10 digits plus a leading zero, point
+  char *end = buf + sizeof(buf);
+  char *str = formatFixed(end, value < 0 ? -(unsigned long)value : value, decimals);
+  if (value < 0) *--str = '-';
+  return write(str, end - str);
+}
+
+// printf ////////////////////////////////////////////////////////////////////
+
+// output of printf is collected here and written in bulk when full and at the end
+#define PRINTF_BUFFER 64
+
+struct PrintfBuffer
+{
+  Print &out;
+  size_t n;
+  uint8_t len;
+  char buf[PRINTF_BUFFER];
+  PrintfBuffer(Print &p) : out(p), n(0), len(0) {}
+  void put(char c) {
+    if (len == PRINTF_BUFFER) flush();
+    buf[len++] = c;
+  }
+  void fill(char c, int8_t count) {
+    while (count-- > 0) put(c);
+  }
+  void flush() {
+    n += out.write(buf, len);
+    len = 0;
+  }
+};
+
+static inline char formatChar(const char *&p, bool progmem)
+{
+  return progmem ? pgm_read_byte(p++) : *p++;
+}
+
+size_t Print::printf(const char *format, ...)
+{
+  va_list ap;
+  va_start(ap, format);
+  size_t n = vprintf(format, ap, false);
+  va_end(ap);
+  return n;
+}
+
+size_t Print::printf_P(const char *format, ...)
+{
+  va_list ap;
+  va_start(ap, format);
+  size_t n = vprintf(format, ap, true);
+  va_end(ap);
+  return n;
+}
+
+size_t Print::printf(const __FlashStringHelper *format, ...)
+{
+  va_list ap;
+  va_start(ap, format);
+  size_t n = vprintf((const char *)format, ap, true);
+  va_end(ap);
+  return n;
+}
+
+size_t Print::vprintf(const char *format, va_list ap, bool progmem)
+{
+  PrintfBuffer out(*this);
+  char c;
+  while ((c = formatChar(format, progmem)) != 0) {
+    if (c != '%') {
+      out.put(c);
+      continue;
+    }
+
+    // %[-0][width][.precision][l]conversion
+    bool left = false;
+    char pad = ' ';
+    for (;;) {
+      c = formatChar(format, progmem);
+      if (c == '-') left = true;
+      else if (c == '0') pad = '0';
+      else break;
+    }
+    int8_t width = 0;
+    if (c == '*') {
+      width = va_arg(ap, int);
+      c = formatChar(format, progmem);
+    }
+    for (; c >= '0' && c <= '9'; c = formatChar(format, progmem))
+      width = width * 10 + c - '0';
+    int8_t precision = -1;
+    if (c == '.') {
+      precision = 0;
+      c = formatChar(format, progmem);
+      if (c == '*') {
+        precision = va_arg(ap, int);
+        c = formatChar(format, progmem);
+      }
+      for (; c >= '0' && c <= '9'; c = formatChar(format, progmem))
+        precision = precision * 10 + c - '0';
+    }
+    bool isLong = false;
+    if (c == 'l') {
+      isLong = true;
+      c = formatChar(format, progmem);
+    }
+    if (c == 0) break;
+
+    char num[13]; // sign, 10 digits plus a leading zero, point (and 11 octal digits)
+    char *end = num + sizeof(num);
+    const char *str = end;
+    const char *stop = end; // end of the text to print
+    char sign = 0;
+    uint8_t zeros = 0;
+    bool flash = false;
+    switch (c) {
+      case 'd':
+      case 'i':
+      case 'k': {
+        long v = isLong ? va_arg(ap, long) : va_arg(ap, int);
+        unsigned long m = v < 0 ? -(unsigned long)v : v;
+        if (v < 0) sign = '-';
+        if (c == 'k') {
+          str = formatFixed(end, m, precision < 0 ? 2 : precision);
+          precision = -1;
+        } else {
+          str = formatNumber(end, m, 10);
+        }
+        break;
+      }
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'o': {
+        unsigned long v = isLong ? va_arg(ap, unsigned long) : va_arg(ap, unsigned int);
+        char *digits = formatNumber(end, v, c == 'u' ? 10 : c == 'o' ? 8 : 16);
+        if (c == 'x')
+          for (char *p = digits; p < end; p++)
+            if (*p >= 'A') *p += 'a' - 'A';
+        str = digits;
+        break;
+      }
+      case 'c':
+        num[0] = va_arg(ap, int);
+        str = num;
+        stop = num + 1;
+        break;
+      case 's':
+      case 'S': {
+        str = va_arg(ap, const char *);
+        if (!str) str = "(null)";
+        else flash = c == 'S';
+        const char *p = str;
+        while ((precision < 0 || p - str < precision) && (flash ? pgm_read_byte(p) : *p)) p++;
+        stop = p;
+        precision = -1;
+        pad = ' ';
+        break;
+      }
+      default: // %% and unknown conversions print the character
+        num[0] = c;
+        str = num;
+        stop = num + 1;
+        break;
+    }
+
+    int len = stop - str;
+    if (precision > len) zeros = precision - len;
+    if (precision >= 0 && c != 'c') pad = ' '; // as in printf, a precision turns off 0 padding
+    int8_t fill = width - len - zeros - (sign ? 1 : 0);
+    if (!left && pad == ' ') out.fill(' ', fill);
+    if (sign) out.put(sign);
+    if (!left && pad == '0') out.fill('0', fill);
+    out.fill('0', zeros);
+    for (const char *p = str; p < stop; p++)
+      out.put(flash ? pgm_read_byte(p) : *p);
+    if (left) out.fill(' ', fill);
+  }
+  out.flush();
+  return out.n;
+}
+
 size_t Print::println(const __FlashStringHelper *ifsh)
 {
   size_t n = print(ifsh);
@@ -126,9 +313,7 @@ size_t Print::print(const Printable& x)
 
 size_t Print::println(void)
 {
-  size_t n = print('\r');
-  n += print('\n');
-  return n;
+  return write("\r\n", 2);
 }
 
 size_t Print::println(const String &s)
@@ -203,25 +388,91 @@ size_t Print::println(const Printable& x)
 
 // Private Methods /////////////////////////////////////////////////////////////
 
-size_t Print::printNumber(unsigned long n, uint8_t base) {
-  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-  char *str = &buf[sizeof(buf) - 1];
-
-  *str = '\0';
+static const char PROGMEM digitPairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+// digits of n written backwards ending at end (no terminator), returns the first one.
+// base 10 takes two digits per division and switches to 16 bit divisions as soon
+// as the value fits, power of two bases only shift.
+char *Print::formatNumber(char *end, unsigned long n, uint8_t base)
+{
+  char *str = end;
 
   // prevent crash if called with base == 1
   if (base < 2) base = 10;
 
-  do {
-    unsigned long m = n;
-    n /= base;
-    char c = m - base * n;
-    *--str = c < 10 ? c + '0' : c + 'A' - 10;
-  } while(n);
+  if (base == 10) {
+    while (n > 0xFFFFUL) {
+      unsigned long q = n / 100;
+      str -= 2;
+      memcpy_P(str, digitPairs + 2 * (uint8_t)(n - q * 100), 2);
+      n = q;
+    }
+    uint16_t m = n;
+    while (m >= 100) {
+      uint16_t q = m / 100;
+      str -= 2;
+      memcpy_P(str, digitPairs + 2 * (uint8_t)(m - q * 100), 2);
+      m = q;
+    }
+    if (m >= 10) {
+      str -= 2;
+      memcpy_P(str, digitPairs + 2 * m, 2);
+    } else {
+      *--str = '0' + m;
+    }
+  } else if ((base & (base - 1)) == 0) {
+    uint8_t shift = 1;
+    while ((1 << shift) != base) shift++;
+    do {
+      char c = n & (base - 1);
+      *--str = c < 10 ? c + '0' : c + 'A' - 10;
+      n >>= shift;
+    } while (n);
+  } else {
+    do {
+      unsigned long m = n;
+      n /= base;
+      char c = m - base * n;
+      *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+  }
+  return str;
+}
 
-  return write(str);
+// n / 10^decimals (up to 10 decimals) written backwards ending at end, no sign
+char *Print::formatFixed(char *end, unsigned long n, uint8_t decimals)
+{
+  if (decimals > 10) decimals = 10;
+  char *str = formatNumber(end, n, 10);
+  while (end - str <= decimals) *--str = '0'; // at least one integer digit
+  if (decimals) {
+    memmove(str - 1, str, end - str - decimals);
+    str--;
+    end[-decimals - 1] = '.';
+  }
+  return str;
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long)]; // Assumes 8-bit chars.
+  char *end = buf + sizeof(buf);
+  char *str = formatNumber(end, n, base);
+  return write(str, end - str);
 }
 
+// the text is built in a stack buffer and written in runs, not one print per digit
+#define PRINT_FLOAT_BUFFER 24
+
 size_t Print::printFloat(double number, uint8_t digits) 
 { 
   size_t n = 0;
@@ -231,10 +482,13 @@ size_t Print::printFloat(double number, uint8_t digits)
   if (number > 4294967040.0) return print ("ovf");  // constant determined empirically
   if (number <-4294967040.0) return print ("ovf");  // constant determined empirically
   
+  char buf[PRINT_FLOAT_BUFFER];
+  char *p = buf;
+
   // Handle negative numbers
   if (number < 0.0)
   {
-     n += print('-');
+     *p++ = '-';
      number = -number;
   }
 
@@ -248,21 +502,28 @@ size_t Print::printFloat(double number, uint8_t digits)
   // Extract the integer part of the number and print it
   unsigned long int_part = (unsigned long)number;
   double remainder = number - (double)int_part;
-  n += print(int_part);
+  char *end = buf + sizeof(buf);
+  char *str = formatNumber(end, int_part, 10);
+  memmove(p, str, end - str);
+  p += end - str;
 
   // Print the decimal point, but only if there are digits beyond
   if (digits > 0) {
-    n += print("."); 
+    *p++ = '.';
   }
 
   // Extract digits from the remainder one at a time
   while (digits-- > 0)
   {
+    if (p == end) {
+      n += write(buf, p - buf);
+      p = buf;
+    }
     remainder *= 10.0;
-    int toPrint = int(remainder);
-    n += print(toPrint);
+    uint8_t toPrint = uint8_t(remainder);
+    *p++ = '0' + toPrint;
     remainder -= toPrint; 
   } 
   
-  return n;
+  return n + write(buf, p - buf);
 }
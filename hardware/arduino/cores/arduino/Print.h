@@ -22,6 +22,7 @@
 
 #include <inttypes.h>
 #include <stdio.h> // for size_t
+#include <stdarg.h>
 
 #include "WString.h"
 #include "Printable.h"
@@ -36,6 +37,8 @@ class Print
   private:
     int write_error;
     size_t printNumber(unsigned long, uint8_t);
+    static char *formatNumber(char *end, unsigned long, uint8_t);
+    static char *formatFixed(char *end, unsigned long, uint8_t);
     size_t printFloat(double, uint8_t);
   protected:
     void setWriteError(int err = 1) { write_error = err; }
@@ -51,6 +54,9 @@ class Print
       return write((const uint8_t *)str, strlen(str));
     }
     virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *buffer, size_t size) {
+      return write((const uint8_t *)buffer, size);
+    }
     
     size_t print(const __FlashStringHelper *);
     size_t print(const String &);
@@ -62,6 +68,7 @@ class Print
     size_t print(long, int = DEC);
     size_t print(unsigned long, int = DEC);
     size_t print(double, int = 2);
+    size_t printFixed(long value, uint8_t decimals); // value / 10^decimals without floats
     size_t print(const Printable&);
 
     size_t println(const __FlashStringHelper *);
@@ -76,6 +83,14 @@ class Print
     size_t println(double, int = 2);
     size_t println(const Printable&);
     size_t println(void);
+
+    // formatted output, built in a small buffer and sent with bulk writes
+    // %[-0][width][.precision][l]conversion with d i u x X o c s % and
+    // S (string in PROGMEM), k (fixed point: %.2k of 1205 prints 12.05, l for long)
+    size_t printf(const char *format, ...);
+    size_t printf_P(const char *format, ...); // format in PROGMEM: printf_P(PSTR("%d"), n)
+    size_t printf(const __FlashStringHelper *format, ...); // printf(F("%d"), n)
+    size_t vprintf(const char *format, va_list ap, bool progmem = false);
 };
 
 #endif
@@ -268,3 +268,170 @@ String Stream::readStringUntil(char terminator)
   return ret;
 }
 
+
+// Non-blocking parsing
+//////////////////////////////////////////////////////////////
+
+#define PARSE_NUMBER   0x01  // a number has started
+#define PARSE_NEGATIVE 0x02
+#define PARSE_FRACTION 0x04  // decimal point seen
+#define PARSE_COMPLETE 0x80  // last call ended the token, the next one starts over
+
+// feeds the input to step() one character at a time until it returns
+// something else than STREAM_MORE, the last character stays in the stream
+// if keepLast is set
+// buffered streams are scanned in place, others with peek() and read()
+int Stream::pollInput(StreamParser &parser, int (*step)(StreamParser &, uint8_t, const void *), const void *arg, bool keepLast)
+{
+  const uint8_t *run;
+  size_t length;
+  int c, result;
+
+  if (parser.flags & PARSE_COMPLETE)
+    parser.reset();
+  while ((run = peekBuffer(length)) != NULL && length > 0) {
+    for (size_t i = 0; i < length; i++) {
+      result = step(parser, run[i], arg);
+      if (result != STREAM_MORE) {
+        consume(keepLast ? i : i + 1);
+        parser.flags |= PARSE_COMPLETE;
+        return result;
+      }
+    }
+    consume(length);
+  }
+  if (run == NULL) {
+    while ((c = peek()) >= 0) {
+      result = step(parser, c, arg);
+      if (result != STREAM_MORE) {
+        if (!keepLast) read();
+        parser.flags |= PARSE_COMPLETE;
+        return result;
+      }
+      read();
+    }
+  }
+  return STREAM_MORE;
+}
+
+// same rules as parseInt: leading characters that are not digits (or the
+// minus sign) are skipped, skipChar is ignored inside the number
+static int numberStep(StreamParser &parser, uint8_t c, const void *arg)
+{
+  char skipChar = *(const char *)arg;
+
+  if (c >= '0' && c <= '9') {
+    parser.flags |= PARSE_NUMBER;
+    parser.value = parser.value * 10 + c - '0';
+    if (parser.flags & PARSE_FRACTION)
+      parser.decimals++;
+  }
+  else if (parser.flags & PARSE_NUMBER) {
+    if (c != skipChar) {
+      if (parser.flags & PARSE_NEGATIVE)
+        parser.value = -parser.value;
+      return STREAM_DONE;
+    }
+  }
+  else if (c == '-')
+    parser.flags |= PARSE_NUMBER | PARSE_NEGATIVE;
+  return STREAM_MORE;
+}
+
+static int floatStep(StreamParser &parser, uint8_t c, const void *arg)
+{
+  if (c == '.' && (parser.flags & PARSE_NUMBER)) {
+    parser.flags |= PARSE_FRACTION;
+    return STREAM_MORE;
+  }
+  return numberStep(parser, c, arg);
+}
+
+// same matching as findUntil, terminator can be NULL
+static int matchStep(StreamParser &parser, uint8_t c, const void *arg)
+{
+  const char *target = ((const char * const *)arg)[0];
+  const char *terminator = ((const char * const *)arg)[1];
+
+  if (c != (uint8_t)target[parser.index])
+    parser.index = 0;
+  if (c == (uint8_t)target[parser.index] && target[++parser.index] == 0)
+    return STREAM_DONE;
+  if (terminator != NULL && *terminator) {
+    if (c == (uint8_t)terminator[parser.termIndex]) {
+      if (terminator[++parser.termIndex] == 0)
+        return STREAM_FAIL;
+    }
+    else
+      parser.termIndex = 0;
+  }
+  return STREAM_MORE;
+}
+
+int Stream::pollInt(StreamParser &parser, char skipChar)
+{
+  return pollInput(parser, numberStep, &skipChar, true);
+}
+
+int Stream::pollFloat(StreamParser &parser, float &value, char skipChar)
+{
+  int result = pollInput(parser, floatStep, &skipChar, true);
+  if (result == STREAM_DONE) {
+    value = parser.value;
+    for (uint8_t i = 0; i < parser.decimals; i++)
+      value *= 0.1;
+  }
+  return result;
+}
+
+int Stream::pollFind(StreamParser &parser, const char *target)
+{
+  return pollFindUntil(parser, target, NULL);
+}
+
+int Stream::pollFindUntil(StreamParser &parser, const char *target, const char *terminator)
+{
+  const char *strings[2] = { target, terminator };
+
+  if (*target == 0)
+    return STREAM_DONE;   // a null string is always found
+  return pollInput(parser, matchStep, strings, false);
+}
+
+// received runs are searched and copied with memchr and memcpy when the
+// stream exposes its buffer
+int Stream::pollBytesUntil(StreamParser &parser, char terminator, char *buffer, size_t length)
+{
+  const uint8_t *run;
+  size_t count;
+  int c;
+
+  if (parser.flags & PARSE_COMPLETE)
+    parser.reset();
+  while (parser.index < length) {
+    run = peekBuffer(count);
+    if (run != NULL) {
+      if (count == 0)
+        return STREAM_MORE;
+      if (count > length - parser.index)
+        count = length - parser.index;
+      const uint8_t *end = (const uint8_t *)memchr(run, terminator, count);
+      size_t n = end ? end - run : count;
+      memcpy(buffer + parser.index, run, n);
+      parser.index += n;
+      consume(end ? n + 1 : n);
+      if (end)
+        break;
+    }
+    else {
+      c = read();
+      if (c < 0)
+        return STREAM_MORE;
+      if (c == terminator)
+        break;
+      buffer[parser.index++] = (char)c;
+    }
+  }
+  parser.flags |= PARSE_COMPLETE;
+  return STREAM_DONE;
+}
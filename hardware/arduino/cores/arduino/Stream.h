@@ -35,6 +35,24 @@
 readBytesBetween( pre_string, terminator, buffer, length)
 */
 
+// results of the non-blocking parsing methods (pollInt() & co)
+#define STREAM_MORE 0   // the input ran out before the end of the token, call again later
+#define STREAM_DONE 1   // token complete
+#define STREAM_FAIL -1  // terminator found before the target (pollFindUntil)
+
+// state of a non-blocking parse, kept between calls while a token is incomplete
+// a parser is restarted by the call following a result other than STREAM_MORE
+struct StreamParser
+{
+  long value;        // number read so far (pollInt, pollFloat)
+  size_t index;      // target chars matched (pollFind) or bytes stored (pollBytesUntil)
+  size_t termIndex;  // terminator chars matched (pollFindUntil)
+  uint8_t decimals;  // digits after the decimal point (pollFloat)
+  uint8_t flags;
+  StreamParser() { reset(); }
+  void reset() { value = 0; index = 0; termIndex = 0; decimals = 0; flags = 0; }
+};
+
 class Stream : public Print
 {
   protected:
@@ -43,6 +61,7 @@ class Stream : public Print
     int timedRead();    // private method to read stream with timeout
     int timedPeek();    // private method to peek stream with timeout
     int peekNextDigit(); // returns the next numeric digit in the stream or -1 if timeout
+    int pollInput(StreamParser &parser, int (*step)(StreamParser &, uint8_t, const void *), const void *arg, bool keepLast);
 
   public:
     virtual int available() = 0;
@@ -85,6 +104,32 @@ class Stream : public Print
   String readString();
   String readStringUntil(char terminator);
 
+// non-blocking parsing methods: they consume the input already received and
+// return STREAM_MORE when it runs out before the end of the token, without
+// waiting; the parser keeps the partial token until the next call
+
+  int pollInt(StreamParser &parser, char skipChar = 1); // STREAM_DONE: the number is in parser.value
+  // a number ends on the first character that is not a digit, which is left in the stream
+
+  int pollFloat(StreamParser &parser, float &value, char skipChar = 1); // float version of pollInt
+
+  int pollFind(StreamParser &parser, const char *target); // STREAM_DONE once the target is read
+
+  int pollFindUntil(StreamParser &parser, const char *target, const char *terminator);
+  // as pollFind but STREAM_FAIL if the terminator string is read first
+
+  int pollBytesUntil(StreamParser &parser, char terminator, char *buffer, size_t length);
+  // STREAM_DONE when the terminator is read (not stored) or length bytes are stored
+  // parser.index is the number of bytes placed in the buffer
+
+// direct access to buffered input, for streams with a receive buffer
+
+  virtual const uint8_t *peekBuffer(size_t &length) { length = 0; return NULL; }
+  // returns the first received bytes that are contiguous in memory (length of them)
+  // without removing them, NULL if the stream has no buffer to expose
+
+  virtual void consume(size_t count) { while (count--) read(); } // drops count received bytes
+
   protected:
   long parseInt(char skipChar); // as above but the given skipChar is ignored
   // as above but the given skipChar is ignored
@@ -85,6 +85,13 @@ volatile uint8_t *timer5_pin_port;
 volatile uint8_t timer5_pin_mask;
 #endif
 
+#ifdef USE_VIRTUAL_PINS
+// virtual port of the tone pin (0 for native pins), its branch is sent from the timer ISR
+// only timers 2 and 3 are ever assigned to tone pins
+volatile uint8_t timer2_pin_vport;
+volatile uint8_t timer3_pin_vport;
+#endif
+
 
 #if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
 
@@ -123,6 +130,9 @@ static uint8_t tone_pins[AVAILABLE_TONE_PINS] = { 255 /*, 255, 255 */ };
 
 
 
+// another library running the tone timer (see toneTimerAttach), no tone meanwhile
+static void (* volatile tone_timer_hook)(void);
+
 static int8_t toneBegin(uint8_t _pin)
 {
   int8_t _timer = -1;
@@ -134,6 +144,8 @@ static int8_t toneBegin(uint8_t _pin)
     }
   }
   
+  if (tone_timer_hook) return -1;
+
   // search for an unused timer.
   for (int i = 0; i < AVAILABLE_TONE_PINS; i++) {
     if (tone_pins[i] == 255) {
@@ -184,6 +196,9 @@ static int8_t toneBegin(uint8_t _pin)
         bitWrite(TCCR2B, CS20, 1);
         timer2_pin_port = portOutputRegister(digitalPinToPort(_pin));
         timer2_pin_mask = digitalPinToBitMask(_pin);
+        #ifdef USE_VIRTUAL_PINS
+        timer2_pin_vport = _pin >= NUM_DIGITAL_PINS ? digitalPinToPort(_pin) : 0;
+        #endif
         break;
       #endif
 
@@ -196,6 +211,9 @@ static int8_t toneBegin(uint8_t _pin)
         bitWrite(TCCR3B, CS30, 1);
         timer3_pin_port = portOutputRegister(digitalPinToPort(_pin));
         timer3_pin_mask = digitalPinToBitMask(_pin);
+        #ifdef USE_VIRTUAL_PINS
+        timer3_pin_vport = _pin >= NUM_DIGITAL_PINS ? digitalPinToPort(_pin) : 0;
+        #endif
         break;
       #endif
 
@@ -238,13 +256,30 @@ static int8_t toneBegin(uint8_t _pin)
 
 // frequency (in hertz) and duration (in milliseconds).
 
-void tone(uint8_t _pin, unsigned int frequency, unsigned long duration)
+// virtual pins: every toggle is a branch transfer done by the timer ISR, the frequency
+// is limited to what the branch can take with half the cpu left to the sketch.
+// Branches that can't transfer from an ISR (I2C, network) don't play at all. On SPI
+// branches the ISR may cut into other transfers on the same bus, the branch own ones
+// are protected, anything else sharing that SPI bus should call noTone() first.
+// returns the frequency actually played (0 if no timer was available or the pin can't
+// play tones)
+
+unsigned int tone(uint8_t _pin, unsigned int frequency, unsigned long duration)
 {
   uint8_t prescalarbits = 0b001;
   long toggle_count = 0;
   uint32_t ocr = 0;
   int8_t _timer;
 
+#ifdef USE_VIRTUAL_PINS
+  if (_pin >= NUM_DIGITAL_PINS)
+  {
+    unsigned int fmax = toneMaxFrequency(_pin);
+    if (fmax == 0) return 0;
+    if (frequency > fmax) frequency = fmax;
+  }
+#endif
+
   _timer = toneBegin(_pin);
 
   if (_timer >= 0)
@@ -414,7 +449,44 @@ void tone(uint8_t _pin, unsigned int frequency, unsigned long duration)
 #endif
 
     }
+    return frequency;
+  }
+  return 0;
+}
+
+
+// highest tone frequency a pin can play: native pins are only limited by the timers,
+// virtual pins by the time their branch takes to send a port, 0 if the branch can't
+// send it from an interrupt (Wire would wait forever). The time is measured once per
+// port (the port is sent with its current state, so it is harmless) and kept, a playing
+// tone is not disturbed by measuring again.
+#define TONE_OUT_SAMPLES 4
+
+#ifdef USE_VIRTUAL_PINS
+static unsigned int tone_max_freq[VPINS_PORTS];// per virtual port, 0 until measured
+#endif
+
+unsigned int toneMaxFrequency(uint8_t _pin)
+{
+#ifdef USE_VIRTUAL_PINS
+  if (_pin >= NUM_DIGITAL_PINS)
+  {
+    uint8_t port = digitalPinToPort(_pin);
+    if (port < VPA || port >= VPA + VPINS_PORTS || !vpins_isr_safe(port)) return 0;
+    unsigned int *fmax = &tone_max_freq[port - VPA];
+    if (*fmax) return *fmax;
+    vpins_out(port);// first transfer may carry setup costs
+    unsigned long t = micros();
+    for (uint8_t n = 0; n < TONE_OUT_SAMPLES; n++) vpins_out(port);
+    t = (micros() - t) / TONE_OUT_SAMPLES;
+    if (t < 1) t = 1;
+    // two transfers per period, at most half of the time spent on them
+    t = 250000UL / t;
+    *fmax = t > 0xFFFF ? 0xFFFF : t;
+    return *fmax;
   }
+#endif
+  return 0xFFFF;
 }
 
 
@@ -452,11 +524,17 @@ void disableTimer(uint8_t _timer)
       #if defined(OCR2A)
         OCR2A = 0;
       #endif
+      #ifdef USE_VIRTUAL_PINS
+        timer2_pin_vport = 0;
+      #endif
       break;
 
 #if defined(TIMSK3)
     case 3:
       TIMSK3 = 0;
+      #ifdef USE_VIRTUAL_PINS
+        timer3_pin_vport = 0;
+      #endif
       break;
 #endif
 
@@ -475,6 +553,32 @@ void disableTimer(uint8_t _timer)
 }
 
 
+// the tone timer (the first one of tone_pin_to_timer_PGM) can do other periodic
+// work while no tone plays: its compare A interrupt calls func instead. The caller
+// sets the timer up, detaching puts it back like noTone() does. Sharing the vector
+// this way lets a sketch link both tone() and that library.
+// returns 0 if a tone is playing or the timer is already attached
+uint8_t toneTimerAttach(void (*func)(void))
+{
+  uint8_t ok = 0;
+  uint8_t oldSREG = SREG;
+  cli();
+  if (tone_pins[0] == 255 && !tone_timer_hook) {
+    tone_timer_hook = func;
+    ok = 1;
+  }
+  SREG = oldSREG;
+  return ok;
+}
+
+void toneTimerDetach(void)
+{
+  if (!tone_timer_hook) return;
+  disableTimer(pgm_read_byte(tone_pin_to_timer_PGM));
+  tone_timer_hook = 0;
+}
+
+
 void noTone(uint8_t _pin)
 {
   int8_t _timer = -1;
@@ -534,11 +638,19 @@ ISR(TIMER1_COMPA_vect)
 #ifdef USE_TIMER2
 ISR(TIMER2_COMPA_vect)
 {
+  if (tone_timer_hook)
+  {
+    tone_timer_hook();
+    return;
+  }
 
   if (timer2_toggle_count != 0)
   {
     // toggle the pin
     *timer2_pin_port ^= timer2_pin_mask;
+#ifdef USE_VIRTUAL_PINS
+    if (timer2_pin_vport) vpins_out(timer2_pin_vport);
+#endif
 
     if (timer2_toggle_count > 0)
       timer2_toggle_count--;
@@ -559,18 +671,33 @@ ISR(TIMER2_COMPA_vect)
 #ifdef USE_TIMER3
 ISR(TIMER3_COMPA_vect)
 {
+  if (tone_timer_hook)
+  {
+    tone_timer_hook();
+    return;
+  }
+
   if (timer3_toggle_count != 0)
   {
     // toggle the pin
     *timer3_pin_port ^= timer3_pin_mask;
+#ifdef USE_VIRTUAL_PINS
+    if (timer3_pin_vport) vpins_out(timer3_pin_vport);
+#endif
 
     if (timer3_toggle_count > 0)
       timer3_toggle_count--;
   }
   else
   {
+#ifdef USE_VIRTUAL_PINS
+    uint8_t vport = timer3_pin_vport;
+#endif
     disableTimer(3);
     *timer3_pin_port &= ~(timer3_pin_mask);  // keep pin low after stop
+#ifdef USE_VIRTUAL_PINS
+    if (vport) vpins_out(vport);
+#endif
   }
 }
 #endif
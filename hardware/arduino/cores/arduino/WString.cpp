@@ -43,6 +43,12 @@ String::String(const __FlashStringHelper *pstr)
 	*this = pstr;
 }
 
+String::String(const StringSumHelper &rval)
+{
+	init();
+	move(const_cast<StringSumHelper&>(rval));
+}
+
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
 String::String(String &&rval)
 {
@@ -121,7 +127,7 @@ String::String(double value, unsigned char decimalPlaces)
 
 String::~String()
 {
-	free(buffer);
+	releaseBuffer();
 }
 
 /*********************************************/
@@ -137,11 +143,43 @@ inline void String::init(void)
 
 void String::invalidate(void)
 {
-	if (buffer) free(buffer);
+	releaseBuffer();
 	buffer = NULL;
 	capacity = len = 0;
 }
 
+// String pool: free blocks are chained through their first bytes
+static char *poolStart, *poolEnd;
+static char *poolFree;
+static unsigned char poolBlock;
+
+void String::setPool(void *memory, unsigned int size, unsigned char blockSize)
+{
+	if (blockSize < sizeof(char *)) size = 0;
+	poolStart = poolFree = (char *)memory;
+	poolEnd = poolStart + (size - size % (blockSize ? blockSize : 1));
+	poolBlock = size ? blockSize : 0;
+	for (char *p = poolStart; p < poolEnd; p += blockSize)
+		*(char **)p = p + blockSize < poolEnd ? p + blockSize : NULL;
+	if (poolStart == poolEnd) poolFree = NULL;
+}
+
+static inline unsigned char inPool(const char *p)
+{
+	return p >= poolStart && p < poolEnd;
+}
+
+void String::releaseBuffer(void)
+{
+	if (!buffer || buffer == inlineBuffer) return;
+	if (inPool(buffer)) {
+		*(char **)buffer = poolFree;
+		poolFree = buffer;
+	} else {
+		free(buffer);
+	}
+}
+
 unsigned char String::reserve(unsigned int size)
 {
 	if (buffer && capacity >= size) return 1;
@@ -152,15 +190,42 @@ unsigned char String::reserve(unsigned int size)
 	return 0;
 }
 
+// only called to grow the buffer
 unsigned char String::changeBuffer(unsigned int maxStrLen)
 {
-	char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
-	if (newbuffer) {
-		buffer = newbuffer;
-		capacity = maxStrLen;
+	unsigned int size = maxStrLen + 1;
+	char *newbuffer;
+
+	if (!buffer && size <= STRING_INLINE_SIZE) {
+		buffer = inlineBuffer;
+		capacity = STRING_INLINE_SIZE - 1;
 		return 1;
 	}
-	return 0;
+	if (size <= poolBlock && poolFree) {
+		newbuffer = poolFree;
+		poolFree = *(char **)poolFree;
+		size = poolBlock;
+	} else {
+		if (size % STRING_ALLOC_STEP) size += STRING_ALLOC_STEP - size % STRING_ALLOC_STEP;
+		if (size <= maxStrLen) size = maxStrLen + 1;  // rounding overflowed
+		if (buffer && buffer != inlineBuffer && !inPool(buffer)) {
+			// heap buffers can often grow in place
+			newbuffer = (char *)realloc(buffer, size);
+			if (!newbuffer) return 0;
+			buffer = newbuffer;
+			capacity = size - 1;
+			return 1;
+		}
+		newbuffer = (char *)malloc(size);
+		if (!newbuffer) return 0;
+	}
+	if (buffer) {
+		memcpy(newbuffer, buffer, capacity + 1);
+		releaseBuffer();
+	}
+	buffer = newbuffer;
+	capacity = size - 1;
+	return 1;
 }
 
 /*********************************************/
@@ -189,19 +254,32 @@ String & String::copy(const __FlashStringHelper *pstr, unsigned int length)
 	return *this;
 }
 
-#ifdef __GXX_EXPERIMENTAL_CXX0X__
+// takes the value of rhs, leaving it empty (or invalid when its buffer is
+// taken).  inline buffers are copied, heap and pool buffers change owner
 void String::move(String &rhs)
 {
+	if (!rhs.buffer) {
+		invalidate();
+		return;
+	}
 	if (buffer) {
 		if (capacity >= rhs.len) {
 			strcpy(buffer, rhs.buffer);
 			len = rhs.len;
 			rhs.len = 0;
+			rhs.buffer[0] = 0;
 			return;
 		} else {
-			free(buffer);
+			releaseBuffer();
+			buffer = NULL;
 		}
 	}
+	if (rhs.buffer == rhs.inlineBuffer) {
+		copy(rhs.buffer, rhs.len);
+		rhs.len = 0;
+		rhs.buffer[0] = 0;
+		return;
+	}
 	buffer = rhs.buffer;
 	capacity = rhs.capacity;
 	len = rhs.len;
@@ -209,7 +287,6 @@ void String::move(String &rhs)
 	rhs.capacity = 0;
 	rhs.len = 0;
 }
-#endif
 
 String & String::operator = (const String &rhs)
 {
@@ -221,6 +298,12 @@ String & String::operator = (const String &rhs)
 	return *this;
 }
 
+String & String::operator = (const StringSumHelper &rval)
+{
+	if (this != &rval) move(const_cast<StringSumHelper&>(rval));
+	return *this;
+}
+
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
 String & String::operator = (String &&rval)
 {
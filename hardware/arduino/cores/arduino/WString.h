@@ -34,6 +34,21 @@
 //     -felide-constructors
 //     -std=c++0x
 
+// strings shorter than STRING_INLINE_SIZE are kept inside the String object
+// (no allocation), longer ones get a block from the String pool (see setPool)
+// or from the heap, rounded up to STRING_ALLOC_STEP bytes so that freed blocks
+// fit other strings and growing strings are reallocated less often.
+// STRING_INLINE_SIZE changes the size of String: the core and the sketch must agree on it
+#ifndef STRING_INLINE_SIZE
+#define STRING_INLINE_SIZE 8
+#endif
+#ifndef STRING_ALLOC_STEP
+#define STRING_ALLOC_STEP 16
+#endif
+#if STRING_INLINE_SIZE < 2 || STRING_ALLOC_STEP < 1
+#error STRING_INLINE_SIZE must be at least 2 and STRING_ALLOC_STEP at least 1
+#endif
+
 class __FlashStringHelper;
 #define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
 
@@ -59,6 +74,7 @@ public:
 	String(const char *cstr = "");
 	String(const String &str);
 	String(const __FlashStringHelper *str);
+	String(const StringSumHelper &rval);	// takes the buffer of a concatenation result
 	#ifdef __GXX_EXPERIMENTAL_CXX0X__
 	String(String &&rval);
 	String(StringSumHelper &&rval);
@@ -80,12 +96,19 @@ public:
 	unsigned char reserve(unsigned int size);
 	inline unsigned int length(void) const {return len;}
 
+	// dedicates memory to Strings: it is split in blocks of blockSize bytes
+	// (the longest pooled string is blockSize - 1) and only longer strings, or
+	// all of them once the pool is full, use the heap.  call it once, in
+	// setup() for instance: the pool cannot be changed once it has been used
+	static void setPool(void *memory, unsigned int size, unsigned char blockSize);
+
 	// creates a copy of the assigned value.  if the value is null or
 	// invalid, or if the memory allocation fails, the string will be 
 	// marked as invalid ("if (s)" will be false).
 	String & operator = (const String &rhs);
 	String & operator = (const char *cstr);
 	String & operator = (const __FlashStringHelper *str);
+	String & operator = (const StringSumHelper &rval);
 	#ifdef __GXX_EXPERIMENTAL_CXX0X__
 	String & operator = (String &&rval);
 	String & operator = (StringSumHelper &&rval);
@@ -191,18 +214,18 @@ protected:
 	char *buffer;	        // the actual char array
 	unsigned int capacity;  // the array length minus one (for the '\0')
 	unsigned int len;       // the String length (not counting the '\0')
+	char inlineBuffer[STRING_INLINE_SIZE];  // buffer of short strings
 protected:
 	void init(void);
 	void invalidate(void);
+	void releaseBuffer(void);
 	unsigned char changeBuffer(unsigned int maxStrLen);
 	unsigned char concat(const char *cstr, unsigned int length);
 
 	// copy and move
 	String & copy(const char *cstr, unsigned int length);
 	String & copy(const __FlashStringHelper *pstr, unsigned int length);
-	#ifdef __GXX_EXPERIMENTAL_CXX0X__
 	void move(String &rhs);
-	#endif
 };
 
 class StringSumHelper : public String
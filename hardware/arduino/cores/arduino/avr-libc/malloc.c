@@ -59,6 +59,12 @@ char *__malloc_heap_end = &__heap_end;
 char *__brkval;
 struct __freelist *__flp;
 
+/* Usage counters, read by MemoryStats (see MemoryStats.h). */
+unsigned long __malloc_count;	/* malloc() calls, also those made by realloc() */
+unsigned long __malloc_fails;	/* malloc() calls that returned NULL */
+unsigned long __free_count;	/* free() calls (not counting free(NULL)) */
+char *__brkval_peak;		/* highest __brkval so far */
+
 ATTRIBUTE_CLIB_SECTION
 void *
 malloc(size_t len)
@@ -67,6 +73,8 @@ malloc(size_t len)
 	char *cp;
 	size_t s, avail;
 
+	__malloc_count++;
+
 	/*
 	 * Our minimum chunk size is the size of a pointer (plus the
 	 * size of the "sz" field, but we don't need to account for
@@ -159,11 +167,13 @@ malloc(size_t len)
 	cp = __malloc_heap_end;
 	if (cp == 0)
 		cp = STACK_POINTER() - __malloc_margin;
-	if (cp <= __brkval)
+	if (cp <= __brkval) {
 	  /*
 	   * Memory exhausted.
 	   */
+	  __malloc_fails++;
 	  return 0;
+	}
 	avail = cp - __brkval;
 	/*
 	 * Both tests below are needed to catch the case len >= 0xfffe.
@@ -171,12 +181,15 @@ malloc(size_t len)
 	if (avail >= len && avail >= len + sizeof(size_t)) {
 		fp1 = (struct __freelist *)__brkval;
 		__brkval += len + sizeof(size_t);
+		if (__brkval > __brkval_peak)
+			__brkval_peak = __brkval;
 		fp1->sz = len;
 		return &(fp1->nx);
 	}
 	/*
 	 * Step 4: There's no help, just fail. :-/
 	 */
+	__malloc_fails++;
 	return 0;
 }
 
@@ -191,6 +204,7 @@ free(void *p)
 	/* ISO C says free(NULL) must be a no-op */
 	if (p == 0)
 		return;
+	__free_count++;
 
 	cpnew = p;
 	cpnew -= sizeof(size_t);
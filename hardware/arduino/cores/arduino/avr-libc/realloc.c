@@ -130,6 +130,8 @@ realloc(void *ptr, size_t len)
 			cp1 = STACK_POINTER() - __malloc_margin;
 		if (cp < cp1) {
 			__brkval = cp;
+			if (__brkval > __brkval_peak)
+				__brkval_peak = __brkval;
 			fp1->sz = len;
 			return ptr;
 		}
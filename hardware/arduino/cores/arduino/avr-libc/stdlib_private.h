@@ -48,6 +48,11 @@ extern size_t __malloc_margin;	/* user-changeable before the first malloc() */
 extern char *__malloc_heap_start;
 extern char *__malloc_heap_end;
 
+extern unsigned long __malloc_count;	/* usage counters (MemoryStats) */
+extern unsigned long __malloc_fails;
+extern unsigned long __free_count;
+extern char *__brkval_peak;		/* highest __brkval so far */
+
 extern char __heap_start;
 extern char __heap_end;
 
@@ -18,6 +18,7 @@
 */
 
 #include <Arduino.h>
+#include "wiring_private.h"
 
 int main(void)
 {
@@ -33,6 +34,7 @@ int main(void)
 	for (;;) {
 		loop();
 		if (serialEventRun) serialEventRun();
+		if (tasksRun) tasksRun(1);
 	}
         
 	return 0;
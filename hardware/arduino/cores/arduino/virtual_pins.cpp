@@ -12,41 +12,42 @@ void vpins_init() {
 }
 
 #ifdef VPINS_OPTIMIZE_SPEED
-	//sory this should go to RAM :(
-	char port_to_branch[] = {
-		NOT_A_BRANCH,//0
-		NOT_A_BRANCH,//1
-		NOT_A_BRANCH,//2
-		NOT_A_BRANCH,//3
-		NOT_A_BRANCH,//4
-		NOT_A_BRANCH,//5
-		NOT_A_BRANCH,//6
-		NOT_A_BRANCH,//7
-		NOT_A_BRANCH,//8
-		NOT_A_BRANCH,//9
-		NOT_A_BRANCH,//10
-		NOT_A_BRANCH,//11
-		NOT_A_BRANCH,//12
-		NOT_A_BRANCH,//13
-		NOT_A_BRANCH,//14
-		NOT_A_BRANCH,//15
-		NOT_A_BRANCH,//16
-	};
+	//zero initialized, so it is ready before any static branch constructor runs
+	char port_to_branch[VPINS_PORTS];
 #endif
 
-portBranch* tree[branchLimit]={NOBRANCH,NOBRANCH,NOBRANCH,NOBRANCH};
+portBranch* tree[branchLimit];
 
-//portBranch::portBranch(char sz):size(sz),localPort(port),active(false) {}
+//first fit: lowest free range of sz virtual ports
+char vpins_first_fit(char sz) {
+	for(char p=VPA;p+sz<=VPA+VPINS_PORTS;p++)
+		if (portBranch::freePorts(p,sz)) return p;
+	return NOT_A_PORT;
+}
+
+vpins_allocator portBranch::allocator=vpins_first_fit;
+
+bool portBranch::freePorts(char port,char sz) {
+	if (sz<1 || port<VPA || port+sz>VPA+VPINS_PORTS) return false;
+	for(char p=port;p<port+sz;p++)
+		if (getBranchId(p)!=NOT_A_BRANCH) return false;
+	return true;
+}
 
-portBranch::portBranch(char port, char sz):size(sz),localPort(port),active(false) {
+portBranch::portBranch(char port, char sz):size(sz),localPort(port),active(false),index(NOT_A_BRANCH) {
+	if (port==VP_FREE) localPort=allocator(sz);
+	if (localPort==NOT_A_PORT) return;//out of virtual ports
+	bool virt=localPort>=VPA;//native ports can also be branches (default type does nothing)
+	if (virt && !freePorts(localPort,sz)) return;//out of range or already mounted
 	//find a free branch
 	for(int b=0;b<branchLimit;b++)
 		if (tree[b]==NOBRANCH) {
 			tree[b]=this;
 			index=b;
 			#ifdef VPINS_OPTIMIZE_SPEED
-				for(int p=localPort+size-1;p>=localPort;p--)
-					port_to_branch[p]=b;
+				if (virt)
+					for(int p=localPort+size-1;p>=localPort;p--)
+						port_to_branch[p-VPA]=b+1;
 			#endif
 			active=true;
 			break;
@@ -54,22 +55,26 @@ portBranch::portBranch(char port, char sz):size(sz),localPort(port),active(false
 }
 
 portBranch::~portBranch() {
+	if (!active) return;
 	#ifdef VPINS_OPTIMIZE_SPEED
-		for(int p=localPort+size-1;p>=localPort;p--)
-			port_to_branch[localPort]=NOT_A_BRANCH;
+		if (localPort>=VPA)
+			for(int p=localPort+size-1;p>=localPort;p--)
+				port_to_branch[p-VPA]=0;
 	#endif
 	tree[index]=NOBRANCH;
 	active=false;
 }
 
-int portBranch::pin(int p) {return NUM_DIGITAL_PINS+((localPort-VPA)<<3)+p;}
+//not mounted branches have no pins
+int portBranch::pin(int p) {return active?NUM_DIGITAL_PINS+((localPort-VPA)<<3)+p:NOT_A_VPIN;}
 
 char portBranch::getBranchId(char port) {
 	#ifdef VPINS_OPTIMIZE_SPEED
-		return port_to_branch[port];
+		if (port<VPA || port>=VPA+VPINS_PORTS) return NOT_A_BRANCH;
+		return port_to_branch[port-VPA]-1;
 	#else
 		for(int b=0;b<branchLimit;b++)
-			if (tree[b] && tree[b]->hasPort) return b;
+			if (tree[b] && tree[b]->hasPort(port)) return b;
 		return NOT_A_BRANCH;
 	#endif
 }
@@ -80,6 +85,26 @@ void portBranch::mode() {}//default branch type does nothing
 void portBranch::in() {}//default branch type does nothing
 void portBranch::out() {}//default branch type does nothing
 void portBranch::io() {}//default branch type does nothing
+bool portBranch::analog(char ch,int val) {return false;}//no analog outputs here
+bool portBranch::isrSafe() {return true;}//default branch type does nothing
+
+void portBranch::outStream(char port,const uint8_t* seq,char n) {
+	for(char i=0;i<n;i++) {
+		*portOutputRegister(port)=seq[i];
+		out();
+	}
+}
+
+void portBranch::ioStream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in) {
+	for(char i=0;i<n;i++) {
+		*portOutputRegister(port)=seq[i];
+		out();
+		if (mark[i>>3]&(1<<(i&7))) {
+			this->in();
+			*in++=*portInputRegister(port);
+		}
+	}
+}
 
 //glue functions calling C++ class methods from C --------------------------
 inline void _mode(char port) {
@@ -114,11 +139,43 @@ inline void _io(char port) {
 	tree[branchId]->io();
 }
 
-void vpins_mode(char port) {
-	_mode(port);
+inline char _analog(uint8_t pin,int val) {
+	if (!portBranch::running()) return false;
+	char branchId=portBranch::getBranchId(digitalPinToPort(pin));
+	//this check can be removed if you know what are you doing...
+	if (branchId==NOT_A_BRANCH || branchId<0 || branchId>=branchLimit) return false;
+	return tree[branchId]->analog(pin-tree[branchId]->pin(0),val);
+}
+
+inline void _stream(char port,const uint8_t* seq,char n) {
+	if (!portBranch::running()) return;
+	char branchId=portBranch::getBranchId(port);
+	//this check can be removed if you know what are you doing...
+	if (branchId==NOT_A_BRANCH || branchId<0 || branchId>=branchLimit) return;
+	tree[branchId]->outStream(port,seq,n);
+}
+
+inline void _io_stream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in) {
+	if (!portBranch::running()) return;
+	char branchId=portBranch::getBranchId(port);
+	//this check can be removed if you know what are you doing...
+	if (branchId==NOT_A_BRANCH || branchId<0 || branchId>=branchLimit) return;
+	tree[branchId]->ioStream(port,seq,n,mark,in);
 }
-void vpins_in(char port) {Serial.print("OK!");_in(port);}
-void vpins_out(char port) {Serial.print("OK!");_out(port);}
-void vpins_io(char port) {Serial.print("OK!");_io(port);}
 
+inline char _isr_safe(char port) {
+	char branchId=portBranch::getBranchId(port);
+	if (branchId==NOT_A_BRANCH || branchId<0 || branchId>=branchLimit) return true;
+	return tree[branchId]->isrSafe();
+}
 
+void vpins_mode(char port) {
+	_mode(port);
+}
+void vpins_in(char port) {_in(port);}
+void vpins_out(char port) {_out(port);}
+void vpins_io(char port) {_io(port);}
+char vpins_analog(uint8_t pin,int val) {return _analog(pin,val);}
+void vpins_stream(char port,const uint8_t* seq,char n) {_stream(port,seq,n);}
+void vpins_io_stream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in) {_io_stream(port,seq,n,mark,in);}
+char vpins_isr_safe(char port) {return _isr_safe(port);}
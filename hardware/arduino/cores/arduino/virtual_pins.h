@@ -32,8 +32,13 @@ virtualize device connection to avoid library change due to change in connecting
 		#define VPINS_OPTIMIZE_SPEED
 		//#define VPINS_OPTIMIZE_RAM
 
-		//number of 8bit ports to use
-		#define VPINS_PORTS 4
+		//number of 8bit ports to use (1..4), register memory is sized by this
+		#ifndef VPINS_PORTS
+			#define VPINS_PORTS 4
+		#endif
+		#if VPINS_PORTS<1 || VPINS_PORTS>4
+			#error "VPINS_PORTS must be 1..4"
+		#endif
 		//allocated memory size (in bytes)
 		#define PORTREGSZ 3
 		#define VPINS_SZ (VPINS_PORTS*PORTREGSZ)//we are using 3 bytes per port
@@ -42,21 +47,33 @@ virtualize device connection to avoid library change due to change in connecting
 		#define branchLimit 8
 		#define NOT_A_BRANCH -1
 		#ifdef VPINS_OPTIMIZE_SPEED
-			extern char port_to_branch[];
+			extern char port_to_branch[];//branch index+1 of each virtual port, 0=free
 		#endif
 			
 		#define DDR_VPA (vpins_data+0)
 		#define PORT_VPA (vpins_data+1)
 		#define PIN_VPA (vpins_data+2)
+		#if VPINS_PORTS > 1
 		#define DDR_VPB (vpins_data+3)
 		#define PORT_VPB (vpins_data+4)
 		#define PIN_VPB (vpins_data+5)
+		#endif
+		#if VPINS_PORTS > 2
 		#define DDR_VPC (vpins_data+6)
 		#define PORT_VPC (vpins_data+7)
 		#define PIN_VPC (vpins_data+8)
+		#endif
+		#if VPINS_PORTS > 3
 		#define DDR_VPD (vpins_data+9)
 		#define PORT_VPD (vpins_data+10)
 		#define PIN_VPD (vpins_data+11)
+		#endif
+
+		//pins past the port tables (only VPINS_PORTS virtual ports have entries)
+		#define NUM_VIRTUAL_PINS (VPINS_PORTS*8)
+		#define NUM_MAPPED_PINS (NUM_DIGITAL_PINS+NUM_VIRTUAL_PINS)
+		//pin of an unmounted branch, rejected by the pin functions (NOT_A_PIN is D0)
+		#define NOT_A_VPIN 0xFF
 
 		#define VP0 20
 		#define VP1 21
@@ -67,15 +84,18 @@ virtualize device connection to avoid library change due to change in connecting
 		#define VP6 26
 		#define VP7 27
 	
+		#if VPINS_PORTS > 1
 		#define VP8 28
 		#define VP9 29
 		#define VP10 30
 		#define VP11 31
-		#define VP12 31
+		#define VP12 32
 		#define VP13 33
 		#define VP14 34
 		#define VP15 35
+		#endif
 	
+		#if VPINS_PORTS > 2
 		#define VP16 36
 		#define VP17 37
 		#define VP18 38
@@ -84,7 +104,9 @@ virtualize device connection to avoid library change due to change in connecting
 		#define VP21 41
 		#define VP22 42
 		#define VP23 43
+		#endif
 	
+		#if VPINS_PORTS > 3
 		#define VP24 44
 		#define VP25 45
 		#define VP26 46
@@ -93,11 +115,13 @@ virtualize device connection to avoid library change due to change in connecting
 		#define VP29 49
 		#define VP30 50
 		#define VP31 51
+		#endif
 	
 		#define VPA 13
 		#define VPB 14
 		#define VPC 15
 		#define VPD 16
+		#define VP_FREE 0//let the allocator pick the port range
 
 		//utility macros
 		#define on(x) digitalWrite(x,1)
@@ -111,9 +135,15 @@ virtualize device connection to avoid library change due to change in connecting
 		//virtual pin 35 = VP15 = VP(VPA,15) = VP(VPB,7) = vpA(15) = vpB(7)
 		#define VP(port,pin) (NUM_DIGITAL_PINS+(port-VPA)*8+pin)
 		#define vpA(pin) (VP(VPA,pin))
+		#if VPINS_PORTS > 1
 		#define vpB(pin) (VP(VPB,pin))
+		#endif
+		#if VPINS_PORTS > 2
 		#define vpC(pin) (VP(VPC,pin))
+		#endif
+		#if VPINS_PORTS > 3
 		#define vpD(pin) (VP(VPD,pin))
+		#endif
 
 		#ifdef USE_VIRTUAL_PINS
 			#ifdef __cplusplus
@@ -125,6 +155,12 @@ virtualize device connection to avoid library change due to change in connecting
 			void vpins_in(char port);
 			void vpins_out(char port);
 			void vpins_io(char port);//use portmap to dispatch network port (includes SPI)
+			char vpins_analog(uint8_t pin,int val);//route analogWrite to the owning branch, returns 0 if not handled
+			void vpins_stream(char port,const uint8_t* seq,char n);//play n output states of a port, in one transfer when the media allows
+			//play n output states and sample the port input after the states flagged on mark (bit i&7 of mark[i>>3])
+			//samples go to in[] in order, one input byte each
+			void vpins_io_stream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in);
+			char vpins_isr_safe(char port);//port transfers can be done from an interrupt handler (true for unmounted ports)
 			#ifdef __cplusplus
 			}
 			#endif
@@ -138,6 +174,9 @@ virtualize device connection to avoid library change due to change in connecting
 
 			#define NOBRANCH ((portBranch*)0)
 			class portBranch;
+			//return first port of a free range of sz virtual ports, or NOT_A_PORT
+			typedef char (*vpins_allocator)(char sz);
+			char vpins_first_fit(char sz);
 			//extern portBranch* tree[branchLimit];
 			//extern portBranch* debug_branch;
 			
@@ -150,15 +189,15 @@ virtualize device connection to avoid library change due to change in connecting
 				bool active;//branch mounted ok?
 				char size;//number of ports on this chain (must be sequential)
 				char localPort;//local port nr, it can be a virtual port :D
+				//port can be VP_FREE, check active after construction (false when out of ports or branches)
 				portBranch(char port, char sz);
-				//portBranch(char sz);
 				virtual ~portBranch();
+				static vpins_allocator allocator;//used for VP_FREE ports, can be replaced
 				inline static bool running() {return portBranch::vpins_running;}
 				inline bool hasPort(char port) {return port>=localPort && port<(localPort+size);}
 				//inline 
 				int pin(int p);// {return 20+((localPort-VPA)<<3)+p;}//NUM_DIGITAL_PINS not available here? damn weird compiling schema!
-				/*static inline int freePort() {
-					for(int i=0;i<ports_limit;i++) if (port_to_Branch[i]}*/
+				static bool freePorts(char port,char sz);//virtual ports in range and not mounted
 				static char getBranchId(char port);
 				static portBranch& getBranch(char port);
 				//this functions kick data in/out of the virtual ports
@@ -170,6 +209,18 @@ virtualize device connection to avoid library change due to change in connecting
 				virtual void in();
 				virtual void out();
 				virtual void io();
+				//analog output channel (DAC/PWM chips), ch is the pin index inside this branch
+				//return false to fallback to the digital threshold of analogWrite
+				virtual bool analog(char ch,int val);
+				//play a sequence of output states on one of this branch ports
+				//default does one out() per state, branches that can do it in one transfer should override
+				virtual void outStream(char port,const uint8_t* seq,char n);
+				//same with input samples after the states flagged on mark (bit i&7 of mark[i>>3]), stored in order on in
+				//default does one out() per state and one in() per sample
+				virtual void ioStream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in);
+				//transfers can run inside an interrupt handler (tone, servo, pin change)
+				//branches that wait on interrupts (Wire) or on the network must return false
+				virtual bool isrSafe();
 			};
 
 		#endif
@@ -37,7 +37,22 @@
 #define FRACT_INC ((MICROSECONDS_PER_TIMER0_OVERFLOW % 1000) >> 3)
 #define FRACT_MAX (1000 >> 3)
 
+#if defined(TCNT0)
+#define TIMER0_COUNT TCNT0
+#elif defined(TCNT0L)
+#define TIMER0_COUNT TCNT0L
+#else
+#error TIMER 0 not defined
+#endif
+
+#ifdef TIFR0
+#define TIMER0_FLAGS TIFR0
+#else
+#define TIMER0_FLAGS TIFR
+#endif
+
 volatile unsigned long timer0_overflow_count = 0;
+volatile unsigned int timer0_overflow_high = 0; // wraps of timer0_overflow_count
 volatile unsigned long timer0_millis = 0;
 static unsigned char timer0_fract = 0;
 
@@ -61,7 +76,8 @@ ISR(TIMER0_OVF_vect)
 
 	timer0_fract = f;
 	timer0_millis = m;
-	timer0_overflow_count++;
+	if (++timer0_overflow_count == 0)
+		timer0_overflow_high++;
 }
 
 unsigned long millis()
@@ -78,32 +94,54 @@ unsigned long millis()
 	return m;
 }
 
+// The timer readers below leave interrupts alone, so they are cheap and
+// can be used in interrupt handlers.  The overflow count is read again
+// until it did not change while the timer was read, and an overflow the
+// handler has not counted yet (interrupts off) is added.
+
 unsigned long micros() {
 	unsigned long m;
-	uint8_t oldSREG = SREG, t;
-	
-	cli();
-	m = timer0_overflow_count;
-#if defined(TCNT0)
-	t = TCNT0;
-#elif defined(TCNT0L)
-	t = TCNT0L;
-#else
-	#error TIMER 0 not defined
-#endif
+	uint8_t t, pending;
 
-  
-#ifdef TIFR0
-	if ((TIFR0 & _BV(TOV0)) && (t < 255))
-		m++;
-#else
-	if ((TIFR & _BV(TOV0)) && (t < 255))
-		m++;
-#endif
+	do {
+		m = timer0_overflow_count;
+		t = TIMER0_COUNT;
+		pending = (TIMER0_FLAGS & _BV(TOV0)) && (t < 255);
+	} while (m != timer0_overflow_count);
 
-	SREG = oldSREG;
-	
-	return ((m << 8) + t) * (64 / clockCyclesPerMicrosecond());
+	return (((m + pending) << 8) + t) * (64 / clockCyclesPerMicrosecond());
+}
+
+uint16_t timerTicks()
+{
+	// only the low byte of the count is needed (AVR is little endian)
+	volatile uint8_t *count = (volatile uint8_t *)&timer0_overflow_count;
+	uint8_t m, t, pending;
+
+	do {
+		m = *count;
+		t = TIMER0_COUNT;
+		pending = (TIMER0_FLAGS & _BV(TOV0)) && (t < 255);
+	} while (m != *count);
+
+	return ((uint16_t)(uint8_t)(m + pending) << 8) | t;
+}
+
+uint64_t timerTicks64()
+{
+	unsigned long m;
+	unsigned int h;
+	uint8_t t, pending;
+
+	// the high word is read after the count, an overflow in between changes the count
+	do {
+		m = timer0_overflow_count;
+		h = timer0_overflow_high;
+		t = TIMER0_COUNT;
+		pending = (TIMER0_FLAGS & _BV(TOV0)) && (t < 255);
+	} while (m != timer0_overflow_count);
+
+	return (((((uint64_t)h << 32) | m) + pending) << 8) | t;
 }
 
 void delay(unsigned long ms)
@@ -111,6 +149,7 @@ void delay(unsigned long ms)
 	uint16_t start = (uint16_t)micros();
 
 	while (ms > 0) {
+		if (tasksRun) tasksRun(0);
 		if (((uint16_t)micros() - start) >= 1000) {
 			ms--;
 			start += 1000;
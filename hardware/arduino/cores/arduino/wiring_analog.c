@@ -26,6 +26,9 @@
 
 #include "wiring_private.h"
 #include "pins_arduino.h"
+#ifdef USE_VIRTUAL_PINS
+	#include "virtual_pins.h"
+#endif
 
 uint8_t analog_reference = DEFAULT;
 
@@ -99,8 +102,13 @@ int analogRead(uint8_t pin)
 // hardware support.  These are defined in the appropriate
 // pins_*.c file.  For the rest of the pins, we default
 // to digital output.
+// Virtual pins are offered to their branch first, DAC and PWM
+// driver branches (PCA9685, MCP4725, MCP4922) take the value.
 void analogWrite(uint8_t pin, int val)
 {
+	#ifdef USE_VIRTUAL_PINS
+		if (pin>=NUM_DIGITAL_PINS && vpins_analog(pin,val)) return;
+	#endif
 	// We need to make sure the PWM output is enabled for those pins
 	// that support it, as we turn it off when digitally reading or
 	// writing with them.  Also, make sure the pin is in output mode
@@ -0,0 +1,159 @@
+/*
+  wiring_pcint.c - pin change interrupts on any native pin
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+// The pin change vectors are defined here, apart from attachInterrupt(), so
+// they are only linked by sketches that use them: SoftwareSerial defines the
+// same vectors and cannot be used together with attachPinChangeInterrupt().
+
+#include "wiring_private.h"
+#include "pins_arduino.h"
+
+#if defined(PCICR) && defined(digitalPinToPCICR)
+
+#if defined(PCINT3_vect)
+#define PCINT_GROUPS 4
+#elif defined(PCINT2_vect)
+#define PCINT_GROUPS 3
+#elif defined(PCINT1_vect)
+#define PCINT_GROUPS 2
+#else
+#define PCINT_GROUPS 1
+#endif
+
+// one per PCMSK register, its pins must be on one port at the same bits
+typedef struct {
+	volatile uint8_t *pin;  // input register of the port
+	uint8_t last;           // levels at the last interrupt
+	uint8_t rising;         // pins reporting rising edges
+	uint8_t falling;        // pins reporting falling edges
+	voidFuncPtr func[8];
+} pcint_group;
+
+static pcint_group pcintGroups[PCINT_GROUPS];
+
+// finds the group and bit of a pin, NULL if it has no usable pin change interrupt
+static pcint_group *pcintGroup(uint8_t pin, uint8_t *bit)
+{
+	uint8_t group;
+
+	if (!digitalPinToPCICR(pin)) return NULL;
+	group = digitalPinToPCICRbit(pin);
+	*bit = digitalPinToPCMSKbit(pin);
+	if (group >= PCINT_GROUPS || digitalPinToBitMask(pin) != _BV(*bit)) return NULL;
+	return &pcintGroups[group];
+}
+
+// mode is CHANGE, RISING or FALLING (others act as CHANGE)
+//
+// For the INT line of a port expander, only set a volatile flag in the
+// handler and refresh the virtual ports from loop() or a task: I2C branches
+// wait on the TWI interrupt, which can not run inside this one.
+uint8_t attachPinChangeInterrupt(uint8_t pin, void (*userFunc)(void), int mode)
+{
+	uint8_t bit, mask, oldSREG;
+	volatile uint8_t *in;
+	pcint_group *g = pcintGroup(pin, &bit);
+
+	if (!g || !userFunc) return 0;
+	in = portInputRegister(digitalPinToPort(pin));
+	if ((g->rising | g->falling) && g->pin != in) return 0;
+	mask = _BV(bit);
+
+	oldSREG = SREG;
+	cli();
+	g->pin = in;
+	g->func[bit] = userFunc;
+	g->last = (g->last & ~mask) | (*in & mask);
+	if (mode == FALLING) g->rising &= ~mask;
+	else g->rising |= mask;
+	if (mode == RISING) g->falling &= ~mask;
+	else g->falling |= mask;
+	*digitalPinToPCMSK(pin) |= mask;
+	*digitalPinToPCICR(pin) |= _BV(digitalPinToPCICRbit(pin));
+	SREG = oldSREG;
+	return 1;
+}
+
+void detachPinChangeInterrupt(uint8_t pin)
+{
+	uint8_t bit, mask, oldSREG;
+	pcint_group *g = pcintGroup(pin, &bit);
+
+	if (!g) return;
+	mask = _BV(bit);
+
+	oldSREG = SREG;
+	cli();
+	g->rising &= ~mask;
+	g->falling &= ~mask;
+	*digitalPinToPCMSK(pin) &= ~mask;
+	if (!*digitalPinToPCMSK(pin))
+		*digitalPinToPCICR(pin) &= ~_BV(digitalPinToPCICRbit(pin));
+	SREG = oldSREG;
+}
+
+// changed pins come from one XOR with the last levels, only the changed pins
+// with a handler for that edge are dispatched
+static inline void pcintDispatch(pcint_group *g)
+{
+	uint8_t now = *g->pin;
+	uint8_t changed = now ^ g->last;
+	uint8_t fire = changed & ((now & g->rising) | (~now & g->falling));
+	voidFuncPtr *func = g->func;
+
+	g->last = now;
+	for (; fire; fire >>= 1, func++)
+		if (fire & 1) (*func)();
+}
+
+ISR(PCINT0_vect) {
+	pcintDispatch(&pcintGroups[0]);
+}
+
+#if PCINT_GROUPS > 1
+ISR(PCINT1_vect) {
+	pcintDispatch(&pcintGroups[1]);
+}
+#endif
+
+#if PCINT_GROUPS > 2
+ISR(PCINT2_vect) {
+	pcintDispatch(&pcintGroups[2]);
+}
+#endif
+
+#if PCINT_GROUPS > 3
+ISR(PCINT3_vect) {
+	pcintDispatch(&pcintGroups[3]);
+}
+#endif
+
+#else
+
+uint8_t attachPinChangeInterrupt(uint8_t pin, void (*userFunc)(void), int mode)
+{
+	return 0;
+}
+
+void detachPinChangeInterrupt(uint8_t pin)
+{
+}
+
+#endif
@@ -64,6 +64,9 @@ extern "C"{
 
 typedef void (*voidFuncPtr)(void);
 
+// runs the due tasks (wiring_tasks.c), only linked when tasks are used
+void tasksRun(uint8_t mayIdle) __attribute__((weak));
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
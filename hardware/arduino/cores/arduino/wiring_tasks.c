@@ -0,0 +1,135 @@
+/*
+  wiring_tasks.c - cooperative tasks run around loop()
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include <avr/sleep.h>
+#include "wiring_private.h"
+
+#ifndef TASKS_MAX
+#define TASKS_MAX 8
+#endif
+
+// no task can be due sooner than this when sleeping: timer 0 overflows
+// wake the CPU at least that often
+#define TASKS_IDLE_MIN (clockCyclesToMicroseconds(64 * 256))
+
+typedef struct {
+	voidFuncPtr func;        // NULL for a free slot
+	unsigned long interval;  // 0 for a one-shot task
+	unsigned long deadline;
+	task_stats stats;
+} task;
+
+static task tasks[TASKS_MAX];
+static uint8_t tasksBusy;   // set while a task runs (delay() in a task does not nest)
+static uint8_t tasksIdle;
+
+static int8_t taskAdd(voidFuncPtr func, unsigned long interval, unsigned long delay)
+{
+	int8_t id;
+
+	for (id = 0; id < TASKS_MAX; id++) {
+		task *t = &tasks[id];
+		if (t->func) continue;
+		t->interval = interval;
+		t->deadline = micros() + delay;
+		t->stats.runs = t->stats.busy = 0;
+		t->stats.longest = t->stats.latest = 0;
+		t->func = func;
+		return id;
+	}
+	return -1;
+}
+
+int8_t taskEvery(voidFuncPtr func, unsigned long interval)
+{
+	if (!func || !interval) return -1;
+	return taskAdd(func, interval, interval);
+}
+
+int8_t taskAfter(voidFuncPtr func, unsigned long delay)
+{
+	if (!func) return -1;
+	return taskAdd(func, 0, delay);
+}
+
+void taskStop(int8_t id)
+{
+	if (id >= 0 && id < TASKS_MAX) tasks[id].func = NULL;
+}
+
+uint8_t taskStats(int8_t id, task_stats *stats)
+{
+	if (id < 0 || id >= TASKS_MAX || !tasks[id].func) return 0;
+	*stats = tasks[id].stats;
+	return 1;
+}
+
+void taskIdleSleep(uint8_t enable)
+{
+	tasksIdle = enable;
+}
+
+static void tasksSleep(unsigned long now)
+{
+	uint8_t id;
+
+	for (id = 0; id < TASKS_MAX; id++)
+		if (tasks[id].func && (long)(tasks[id].deadline - now) < (long)TASKS_IDLE_MIN) return;
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	cli();
+	sleep_enable();
+	sei();
+	sleep_cpu();  // sei takes effect after this, so no interrupt is missed
+	sleep_disable();
+}
+
+void tasksRun(uint8_t mayIdle)
+{
+	uint8_t id;
+	unsigned long now, took, late;
+
+	if (tasksBusy) return;
+	tasksBusy = 1;
+	for (id = 0; id < TASKS_MAX; id++) {
+		task *t = &tasks[id];
+		voidFuncPtr func = t->func;
+		if (!func) continue;
+		now = micros();
+		late = now - t->deadline;
+		if ((long)late < 0) continue;
+		if (!t->interval) {
+			t->func = NULL;  // one-shot, the slot is free for the task to schedule itself again
+			func();
+			continue;
+		}
+		// fixed rate, but missed periods are dropped rather than run in a burst
+		t->deadline += t->interval;
+		if ((long)(now - t->deadline) >= 0) t->deadline = now + t->interval;
+		func();
+		took = micros() - now;
+		if (t->func != func) continue;  // stopped while running
+		t->stats.runs++;
+		t->stats.busy += took;
+		if (took > t->stats.longest) t->stats.longest = took > 0xFFFF ? 0xFFFF : took;
+		if (late > t->stats.latest) t->stats.latest = late > 0xFFFF ? 0xFFFF : late;
+	}
+	tasksBusy = 0;
+	if (mayIdle && tasksIdle) tasksSleep(micros());
+}
@@ -121,10 +121,16 @@ const uint16_t PROGMEM port_to_mode_PGM[] = {
 	NOT_A_PORT,
 	NOT_A_PORT,
 	(uint16_t) DDR_VPA,
+#if VPINS_PORTS > 1
 	(uint16_t) DDR_VPB,
+#endif
+#if VPINS_PORTS > 2
 	(uint16_t) DDR_VPC,
+#endif
+#if VPINS_PORTS > 3
 	(uint16_t) DDR_VPD,
 #endif
+#endif
 };
 
 const uint16_t PROGMEM port_to_output_PGM[] = {
@@ -143,10 +149,16 @@ const uint16_t PROGMEM port_to_output_PGM[] = {
 	NOT_A_PORT,//11
 	NOT_A_PORT,//12
 	(uint16_t) PORT_VPA,//13
+#if VPINS_PORTS > 1
 	(uint16_t) PORT_VPB,//14
+#endif
+#if VPINS_PORTS > 2
 	(uint16_t) PORT_VPC,//15
+#endif
+#if VPINS_PORTS > 3
 	(uint16_t) PORT_VPD,//16
 #endif
+#endif
 };
 
 const uint16_t PROGMEM port_to_input_PGM[] = {
@@ -165,9 +177,15 @@ const uint16_t PROGMEM port_to_input_PGM[] = {
 	NOT_A_PORT,//11
 	NOT_A_PORT,//12
 	(uint16_t) PIN_VPA,//13 
+#if VPINS_PORTS > 1
 	(uint16_t) PIN_VPB,//14
+#endif
+#if VPINS_PORTS > 2
 	(uint16_t) PIN_VPC,//15
+#endif
+#if VPINS_PORTS > 3
 	(uint16_t) PIN_VPD,//16
+#endif
 #endif //USE_VIRTUAL_PINS
 };
 
@@ -203,6 +221,7 @@ const uint8_t PROGMEM digital_pin_to_port_PGM[] = {
 	VPA,
 	VPA,
 	
+#if VPINS_PORTS > 1
 	VPB,
 	VPB,
 	VPB,
@@ -211,7 +230,9 @@ const uint8_t PROGMEM digital_pin_to_port_PGM[] = {
 	VPB,
 	VPB,
 	VPB,
+#endif
 	
+#if VPINS_PORTS > 2
 	VPC,
 	VPC,
 	VPC,
@@ -220,7 +241,9 @@ const uint8_t PROGMEM digital_pin_to_port_PGM[] = {
 	VPC,
 	VPC,
 	VPC,
+#endif
 	
+#if VPINS_PORTS > 3
 	VPD,
 	VPD,
 	VPD,
@@ -229,6 +252,7 @@ const uint8_t PROGMEM digital_pin_to_port_PGM[] = {
 	VPD,
 	VPD,
 	VPD,
+#endif
 	
 #endif //USE_VIRTUAL_PINS	
 };
@@ -263,6 +287,7 @@ const uint8_t PROGMEM digital_pin_to_bit_mask_PGM[] = {
 	_BV(5),
 	_BV(6),
 	_BV(7),
+#if VPINS_PORTS > 1
 	_BV(0), /* 28, port PORT_VPB */
 	_BV(1),
 	_BV(2),
@@ -271,6 +296,8 @@ const uint8_t PROGMEM digital_pin_to_bit_mask_PGM[] = {
 	_BV(5),
 	_BV(6),
 	_BV(7),
+#endif
+#if VPINS_PORTS > 2
 	_BV(0), /* 36, port PORT_VPC */
 	_BV(1),
 	_BV(2),
@@ -279,6 +306,8 @@ const uint8_t PROGMEM digital_pin_to_bit_mask_PGM[] = {
 	_BV(5),
 	_BV(6),
 	_BV(7),
+#endif
+#if VPINS_PORTS > 3
 	_BV(0), /* 44, port PORT_VPD */
 	_BV(1),
 	_BV(2),
@@ -287,6 +316,7 @@ const uint8_t PROGMEM digital_pin_to_bit_mask_PGM[] = {
 	_BV(5),
 	_BV(6),
 	_BV(7),
+#endif
 #endif //USE_VIRTUAL_PINS
 };
 
@@ -335,6 +365,7 @@ const uint8_t PROGMEM digital_pin_to_timer_PGM[] = {
 	NOT_ON_TIMER,
 	NOT_ON_TIMER,
 	NOT_ON_TIMER,
+#if VPINS_PORTS > 1
 	NOT_ON_TIMER,
 	NOT_ON_TIMER,
 	NOT_ON_TIMER,
@@ -343,6 +374,8 @@ const uint8_t PROGMEM digital_pin_to_timer_PGM[] = {
 	NOT_ON_TIMER,
 	NOT_ON_TIMER,
 	NOT_ON_TIMER,
+#endif
+#if VPINS_PORTS > 2
 	NOT_ON_TIMER,
 	NOT_ON_TIMER,
 	NOT_ON_TIMER,
@@ -351,6 +384,8 @@ const uint8_t PROGMEM digital_pin_to_timer_PGM[] = {
 	NOT_ON_TIMER,
 	NOT_ON_TIMER,
 	NOT_ON_TIMER,
+#endif
+#if VPINS_PORTS > 3
 	NOT_ON_TIMER,
 	NOT_ON_TIMER,
 	NOT_ON_TIMER,
@@ -360,6 +395,7 @@ const uint8_t PROGMEM digital_pin_to_timer_PGM[] = {
 	NOT_ON_TIMER,
 	NOT_ON_TIMER,
 #endif
+#endif
 };
 
 #endif
@@ -361,6 +361,74 @@ static inline unsigned char writePort(byte port, byte value, byte bitmask)
 #define TOTAL_PORTS             ((TOTAL_PINS + 7) / 8)
 #endif
 
+/*==============================================================================
+ * Virtual ports (VPA, VPB, ...) follow the native ones as extra Firmata ports.
+ * Firmata pin number of a virtual pin is port*8+bit, starting at
+ * FIRST_VIRTUAL_PIN.  Reads come from the PIN_VPx snapshot taken by
+ * refreshVirtualPorts(), writes are one vpins_out() per port.
+ *============================================================================*/
+
+#ifdef USE_VIRTUAL_PINS
+#define TOTAL_VIRTUAL_PORTS     VPINS_PORTS
+#define FIRST_VIRTUAL_PORT      TOTAL_PORTS
+#define FIRST_VIRTUAL_PIN       (FIRST_VIRTUAL_PORT * 8)
+#define IS_PORT_VIRTUAL(p)      ((p) >= FIRST_VIRTUAL_PORT && (p) < FIRST_VIRTUAL_PORT + TOTAL_VIRTUAL_PORTS)
+#define IS_PIN_VIRTUAL(p)       ((p) >= FIRST_VIRTUAL_PIN && (p) < FIRST_VIRTUAL_PIN + TOTAL_VIRTUAL_PORTS * 8)
+#define PORT_TO_VIRTUAL(p)      (VPA + (p) - FIRST_VIRTUAL_PORT)
+#define PIN_TO_VIRTUAL(p)       (NUM_DIGITAL_PINS + (p) - FIRST_VIRTUAL_PIN)
+#define TOTAL_FIRMATA_PORTS     (TOTAL_PORTS + TOTAL_VIRTUAL_PORTS)
+#define TOTAL_FIRMATA_PINS      (FIRST_VIRTUAL_PIN + TOTAL_VIRTUAL_PORTS * 8)
+#else
+#define TOTAL_VIRTUAL_PORTS     0
+#define IS_PORT_VIRTUAL(p)      0
+#define IS_PIN_VIRTUAL(p)       0
+#define TOTAL_FIRMATA_PORTS     TOTAL_PORTS
+#define TOTAL_FIRMATA_PINS      TOTAL_PINS
+#endif
+
+#ifdef USE_VIRTUAL_PINS
+/*==============================================================================
+ * refreshVirtualPorts() - take a new input snapshot of the reported virtual
+ * ports, one bus read per branch (a branch reads all its ports at once)
+ *============================================================================*/
+
+static inline void refreshVirtualPorts(const byte*, const byte*) __attribute__((unused));
+static inline void refreshVirtualPorts(const byte *report, const byte *inputs)
+{
+	byte done = 0; // branches already read on this pass
+	for (byte i=0; i < TOTAL_VIRTUAL_PORTS; i++) {
+		if (!report[i] || !inputs[i]) continue;
+		char b = portBranch::getBranchId(VPA + i);
+		if (b == NOT_A_BRANCH || (done & (1 << b))) continue;
+		done |= 1 << b;
+		vpins_in(VPA + i);
+	}
+}
+
+/*==============================================================================
+ * readVirtualPort() - Read an 8 bit virtual port from the cached snapshot
+ *============================================================================*/
+
+static inline unsigned char readVirtualPort(byte, byte) __attribute__((always_inline, unused));
+static inline unsigned char readVirtualPort(byte port, byte bitmask)
+{
+	return *portInputRegister(PORT_TO_VIRTUAL(port)) & bitmask;
+}
+
+/*==============================================================================
+ * writeVirtualPort() - Write an 8 bit virtual port in a single transaction
+ *============================================================================*/
+
+static inline void writeVirtualPort(byte, byte, byte) __attribute__((always_inline, unused));
+static inline void writeVirtualPort(byte port, byte value, byte bitmask)
+{
+	byte vport = PORT_TO_VIRTUAL(port);
+	volatile uint8_t *out = portOutputRegister(vport);
+	*out = (*out & ~bitmask) | (value & bitmask);
+	vpins_out(vport);
+}
+#endif
+
 
 #endif /* Firmata_Boards_h */
 
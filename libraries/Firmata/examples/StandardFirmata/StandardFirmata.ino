@@ -54,12 +54,12 @@
 int analogInputsToReport = 0; // bitwise array to store pin reporting
 
 /* digital input ports */
-byte reportPINs[TOTAL_PORTS];       // 1 = report this port, 0 = silence
-byte previousPINs[TOTAL_PORTS];     // previous 8 bits sent
+byte reportPINs[TOTAL_FIRMATA_PORTS];       // 1 = report this port, 0 = silence
+byte previousPINs[TOTAL_FIRMATA_PORTS];     // previous 8 bits sent
 
 /* pins configuration */
 byte pinConfig[TOTAL_PINS];         // configuration of every pin
-byte portConfigInputs[TOTAL_PORTS]; // each bit: 1 = pin in INPUT, 0 = anything else
+byte portConfigInputs[TOTAL_FIRMATA_PORTS]; // each bit: 1 = pin in INPUT, 0 = anything else
 int pinState[TOTAL_PINS];           // any value that has been written
 
 /* timer variables */
@@ -165,7 +165,35 @@ void checkDigitalInputs(void)
   if (TOTAL_PORTS > 13 && reportPINs[13]) outputPort(13, readPort(13, portConfigInputs[13]), false);
   if (TOTAL_PORTS > 14 && reportPINs[14]) outputPort(14, readPort(14, portConfigInputs[14]), false);
   if (TOTAL_PORTS > 15 && reportPINs[15]) outputPort(15, readPort(15, portConfigInputs[15]), false);
+#ifdef USE_VIRTUAL_PINS
+  /* virtual ports: one bus read per branch, then report only changes
+   * found on the cached PIN_VPx snapshot */
+  refreshVirtualPorts(reportPINs + FIRST_VIRTUAL_PORT, portConfigInputs + FIRST_VIRTUAL_PORT);
+  for (byte i=FIRST_VIRTUAL_PORT; i < TOTAL_FIRMATA_PORTS && i < 16; i++) {
+    if (reportPINs[i]) outputPort(i, readVirtualPort(i, portConfigInputs[i]), false);
+  }
+#endif
+}
+
+#ifdef USE_VIRTUAL_PINS
+/* virtual pins only do digital INPUT and OUTPUT, the mode lives on DDR_VPx */
+void setVirtualPinMode(byte pin, int mode)
+{
+  byte mask = 1 << (pin & 7);
+  switch(mode) {
+  case INPUT:
+    portConfigInputs[pin/8] |= mask;
+    pinMode(PIN_TO_VIRTUAL(pin), INPUT);
+    break;
+  case OUTPUT:
+    portConfigInputs[pin/8] &= ~mask;
+    pinMode(PIN_TO_VIRTUAL(pin), OUTPUT);
+    break;
+  default:
+    Firmata.sendString("Unknown pin mode");
+  }
 }
+#endif
 
 // -----------------------------------------------------------------------------
 /* sets the pin mode to the correct state and sets the relevant bits in the
@@ -173,6 +201,13 @@ void checkDigitalInputs(void)
  */
 void setPinModeCallback(byte pin, int mode)
 {
+#ifdef USE_VIRTUAL_PINS
+  if (IS_PIN_VIRTUAL(pin)) {
+    setVirtualPinMode(pin, mode);
+    return;
+  }
+#endif
+  if (pin >= TOTAL_PINS) return;
   if (pinConfig[pin] == I2C && isI2CEnabled && mode != I2C) {
     // disable i2c so pins can be used for other functions
     // the following if statements should reconfigure the pins properly
@@ -284,6 +319,11 @@ void digitalWriteCallback(byte port, int value)
     }
     writePort(port, (byte)value, pinWriteMask);
   }
+#ifdef USE_VIRTUAL_PINS
+  else if (IS_PORT_VIRTUAL(port)) {
+    writeVirtualPort(port, (byte)value, 0xFF);
+  }
+#endif
 }
 
 
@@ -306,7 +346,7 @@ void reportAnalogCallback(byte analogPin, int value)
 
 void reportDigitalCallback(byte port, int value)
 {
-  if (port < TOTAL_PORTS) {
+  if (port < TOTAL_FIRMATA_PORTS) {
     reportPINs[port] = (byte)value;
   }
   // do not disable analog reporting on these 8 pins, to allow some
@@ -457,7 +497,19 @@ void sysexCallback(byte command, byte argc, byte *argv)
   case CAPABILITY_QUERY:
     Serial.write(START_SYSEX);
     Serial.write(CAPABILITY_RESPONSE);
-    for (byte pin=0; pin < TOTAL_PINS; pin++) {
+    for (byte pin=0; pin < TOTAL_FIRMATA_PINS; pin++) {
+      if (IS_PIN_VIRTUAL(pin)) {
+        Serial.write((byte)INPUT);
+        Serial.write(1);
+        Serial.write((byte)OUTPUT);
+        Serial.write(1);
+        Serial.write(127);
+        continue;
+      }
+      if (pin >= TOTAL_PINS) {
+        Serial.write(127);
+        continue;
+      }
       if (IS_PIN_DIGITAL(pin)) {
         Serial.write((byte)INPUT);
         Serial.write(1);
@@ -496,14 +548,23 @@ void sysexCallback(byte command, byte argc, byte *argv)
 	if (pinState[pin] & 0xFF80) Serial.write((byte)(pinState[pin] >> 7) & 0x7F);
 	if (pinState[pin] & 0xC000) Serial.write((byte)(pinState[pin] >> 14) & 0x7F);
       }
+#ifdef USE_VIRTUAL_PINS
+      else if (IS_PIN_VIRTUAL(pin)) {
+        byte vpin = PIN_TO_VIRTUAL(pin);
+        byte mask = digitalPinToBitMask(vpin);
+        byte port = digitalPinToPort(vpin);
+        Serial.write((*portModeRegister(port) & mask) ? OUTPUT : INPUT);
+        Serial.write((*portOutputRegister(port) & mask) ? 1 : 0);
+      }
+#endif
       Serial.write(END_SYSEX);
     }
     break;
   case ANALOG_MAPPING_QUERY:
     Serial.write(START_SYSEX);
     Serial.write(ANALOG_MAPPING_RESPONSE);
-    for (byte pin=0; pin < TOTAL_PINS; pin++) {
-      Serial.write(IS_PIN_ANALOG(pin) ? PIN_TO_ANALOG(pin) : 127);
+    for (byte pin=0; pin < TOTAL_FIRMATA_PINS; pin++) {
+      Serial.write(pin < TOTAL_PINS && IS_PIN_ANALOG(pin) ? PIN_TO_ANALOG(pin) : 127);
     }
     Serial.write(END_SYSEX);
     break;
@@ -548,7 +609,7 @@ void systemResetCallback()
   if (isI2CEnabled) {
   	disableI2CPins();
   }
-  for (byte i=0; i < TOTAL_PORTS; i++) {
+  for (byte i=0; i < TOTAL_FIRMATA_PORTS; i++) {
     reportPINs[i] = false;      // by default, reporting off
     portConfigInputs[i] = 0;	// until activated
     previousPINs[i] = 0;
@@ -564,6 +625,16 @@ void systemResetCallback()
       setPinModeCallback(i, OUTPUT);
     }
   }
+#ifdef USE_VIRTUAL_PINS
+  // virtual pins default to digital output, one mode transaction per port
+  for (byte i=FIRST_VIRTUAL_PORT; i < TOTAL_FIRMATA_PORTS; i++) {
+    byte vport = PORT_TO_VIRTUAL(i);
+    *portModeRegister(vport) = 0xFF;
+    *portOutputRegister(vport) = 0;
+    vpins_mode(vport);
+    vpins_out(vport);
+  }
+#endif
   // by default, do not report any analog inputs
   analogInputsToReport = 0;
 
@@ -0,0 +1,125 @@
+#include <Arduino.h>
+#include "KeyMatrix.h"
+
+KeyMatrix::KeyMatrix(const uint8_t* rp,uint8_t nr,const uint8_t* cp,uint8_t nc)
+	:rowPins(rp),colPins(cp),rows(nr>8?8:nr),cols(nc>8?8:nc),row(0),debounce(KEY_DEBOUNCE),head(0),tail(0),last(0),rowInterval(0) {
+	if (rows*cols>KEYMATRIX_MAX_KEYS) rows=KEYMATRIX_MAX_KEYS/cols;
+	rowPort=digitalPinToPort(rowPins[0]);
+	colPort=digitalPinToPort(colPins[0]);
+	rowMask=colMask=0;
+	for(int r=0;r<rows;r++) {
+		if (digitalPinToPort(rowPins[r])!=rowPort) rowPort=NOT_A_PORT;
+		rowMask|=rowBits[r]=digitalPinToBitMask(rowPins[r]);
+	}
+	for(int c=0;c<cols;c++) {
+		if (digitalPinToPort(colPins[c])!=colPort) colPort=NOT_A_PORT;
+		colMask|=colBits[c]=digitalPinToBitMask(colPins[c]);
+	}
+	memset(integ,0,sizeof(integ));
+}
+
+//call after the media is started (pin modes are sent out)
+void KeyMatrix::begin() {
+	for(int c=0;c<cols;c++) pinMode(colPins[c],INPUT_PULLUP);
+	for(int r=0;r<rows;r++) {
+		pinMode(rowPins[r],OUTPUT);
+		digitalWrite(rowPins[r],HIGH);
+	}
+}
+
+void KeyMatrix::setDebounce(uint8_t scans) {debounce=scans<1?1:scans>0x7F?0x7F:scans;}
+
+//active row low, others high
+void KeyMatrix::driveRow(uint8_t r) {
+	if (rowPort!=NOT_A_PORT) {
+		volatile uint8_t *out=portOutputRegister(rowPort);
+		uint8_t oldSREG=SREG;
+		cli();
+		#ifdef USE_VIRTUAL_PINS
+			if (rowPins[0]>=NUM_DIGITAL_PINS) {//expanders: push-pull (quasi-bidirectional on most)
+				*out=(*out|rowMask)&~rowBits[r];
+				SREG=oldSREG;
+				vpins_out(rowPort);
+				return;
+			}
+		#endif
+		//native: open drain, only the active row is an output so two keys down can not short rows
+		volatile uint8_t *ddr=portModeRegister(rowPort);
+		*out&=~rowMask;
+		*ddr=(*ddr&~rowMask)|rowBits[r];
+		SREG=oldSREG;
+		delayMicroseconds(3);//let the columns settle
+		return;
+	}
+	for(int n=0;n<rows;n++) digitalWrite(rowPins[n],n!=r);
+}
+
+//bit c set if column c is low (key down)
+uint8_t KeyMatrix::readCols() {
+	uint8_t down=0;
+	if (colPort!=NOT_A_PORT) {
+		#ifdef USE_VIRTUAL_PINS
+			if (colPins[0]>=NUM_DIGITAL_PINS) vpins_in(colPort);
+		#endif
+		uint8_t v=*portInputRegister(colPort);
+		for(int c=0;c<cols;c++) if (!(v&colBits[c])) down|=1<<c;
+		return down;
+	}
+	for(int c=0;c<cols;c++) if (!digitalRead(colPins[c])) down|=1<<c;
+	return down;
+}
+
+void KeyMatrix::push(uint8_t e) {
+	uint8_t next=(head+1)&(KEYMATRIX_QUEUE-1);
+	if (next==tail) return;//full, event lost
+	queue[head]=e;
+	head=next;
+}
+
+bool KeyMatrix::scan() {
+	if (rowInterval) {
+		unsigned long now=micros();
+		if (now-last<rowInterval) return false;
+		last=now;
+	}
+	driveRow(row);
+	uint8_t down=readCols();
+	//integrators count up while down and down while up, state flips at the ends
+	uint8_t *k=integ+row*cols;
+	for(int c=0;c<cols;c++,k++) {
+		uint8_t n=*k&0x7F;
+		if (down&(1<<c)) {
+			if (n<debounce && ++n==debounce && !(*k&0x80)) {
+				*k=0x80|n;
+				push(KEY_PRESSED|(row*cols+c));
+				continue;
+			}
+		} else if (n>0 && --n==0 && (*k&0x80)) {
+			*k=0;
+			push(row*cols+c);
+			continue;
+		}
+		*k=(*k&0x80)|n;
+	}
+	if (++row<rows) return false;
+	row=0;
+	return true;
+}
+
+void KeyMatrix::scanAll() {
+	unsigned int ri=rowInterval;
+	rowInterval=0;
+	while(!scan());
+	rowInterval=ri;
+}
+
+bool KeyMatrix::isPressed(uint8_t key) {return key<rows*cols && (integ[key]&0x80);}
+
+int KeyMatrix::available() {return (head-tail)&(KEYMATRIX_QUEUE-1);}
+
+int KeyMatrix::read() {
+	if (head==tail) return -1;
+	uint8_t e=queue[tail];
+	tail=(tail+1)&(KEYMATRIX_QUEUE-1);
+	return e;
+}
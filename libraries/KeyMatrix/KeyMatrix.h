@@ -0,0 +1,47 @@
+#ifndef KEY_MATRIX_DEF
+#define KEY_MATRIX_DEF
+
+	#include <Arduino.h>
+
+	//key matrix scanner, rows are driven low one at a time and columns read with pull-ups
+	//when all rows share a port and all columns share a port (native or virtual)
+	//a row costs one port write and one port read (one out/in on virtual ports)
+	//otherwise it falls back to digitalWrite/digitalRead
+	#ifndef KEYMATRIX_MAX_KEYS
+		#define KEYMATRIX_MAX_KEYS 64
+	#endif
+	#define KEYMATRIX_QUEUE 8//events, must be power of 2
+	#define KEY_PRESSED 0x80//event flag, key index on the lower bits
+	#define KEY_INDEX(e) ((e)&0x7F)
+	#define KEY_DEBOUNCE 4//scans a key must be stable
+
+	class KeyMatrix {
+	protected:
+		const uint8_t *rowPins,*colPins;
+		uint8_t rows,cols;
+		uint8_t rowPort,colPort;//NOT_A_PORT if not all on one port
+		uint8_t rowMask,colMask;
+		uint8_t rowBits[8],colBits[8];
+		uint8_t row;//next row to scan
+		uint8_t debounce;
+		uint8_t integ[KEYMATRIX_MAX_KEYS];//bit 7: debounced state, lower bits: integrator
+		uint8_t queue[KEYMATRIX_QUEUE];
+		volatile uint8_t head,tail;
+		unsigned long last;
+		void driveRow(uint8_t r);
+		uint8_t readCols();
+		void push(uint8_t e);
+	public:
+		unsigned int rowInterval;//us between rows for scan(), 0: every call
+		KeyMatrix(const uint8_t* rowPins,uint8_t rows,const uint8_t* colPins,uint8_t cols);
+		void begin();
+		void setDebounce(uint8_t scans);
+		bool scan();//one row if due, true when a full scan is done
+		void scanAll();//all rows now
+		inline uint8_t keys() {return rows*cols;}
+		bool isPressed(uint8_t key);
+		int available();
+		int read();//next event (key index | KEY_PRESSED) or -1
+	};
+
+#endif
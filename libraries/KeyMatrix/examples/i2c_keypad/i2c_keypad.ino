@@ -0,0 +1,32 @@
+/*
+Key matrix scanner
+  4x4 keypad on a PCF8574 expander, rows on pins 0-3 and columns on 4-7
+  each row is one I2C write and one I2C read
+*/
+
+#include <Wire.h>
+#include <VPinsI2C.h>
+#include <KeyMatrix.h>
+
+I2CBranch i2c(Wire,0x20,VP_FREE);
+
+const uint8_t rowPins[]={i2c.pin(0),i2c.pin(1),i2c.pin(2),i2c.pin(3)};
+const uint8_t colPins[]={i2c.pin(4),i2c.pin(5),i2c.pin(6),i2c.pin(7)};
+
+KeyMatrix keypad(rowPins,4,colPins,4);
+
+void setup() {
+  Serial.begin(9600);
+  Wire.begin();
+  keypad.begin();
+}
+
+void loop() {
+  keypad.scan();//one row per call
+  while(keypad.available()) {
+    int e=keypad.read();
+    Serial.print("key ");
+    Serial.print(KEY_INDEX(e));
+    Serial.println(e&KEY_PRESSED?" down":" up");
+  }
+}
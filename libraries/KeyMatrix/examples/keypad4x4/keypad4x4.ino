@@ -0,0 +1,28 @@
+/*
+Key matrix scanner
+  4x4 keypad on native pins, rows on 4-7 and columns on 8-11
+  rows are not on the same port as columns, each is still one port access per row
+*/
+
+#include <KeyMatrix.h>
+
+const uint8_t rowPins[]={4,5,6,7};//PORTD
+const uint8_t colPins[]={8,9,10,11};//PORTB
+const char keymap[]="123A456B789C*0#D";
+
+KeyMatrix keypad(rowPins,4,colPins,4);
+
+void setup() {
+  Serial.begin(9600);
+  keypad.begin();
+  keypad.rowInterval=250;//us, full scan every 1ms
+}
+
+void loop() {
+  keypad.scan();
+  while(keypad.available()) {
+    int e=keypad.read();
+    Serial.print(keymap[KEY_INDEX(e)]);
+    Serial.println(e&KEY_PRESSED?" down":" up");
+  }
+}
@@ -0,0 +1,158 @@
+#include <Arduino.h>
+#include "LedMux.h"
+
+#if defined(TCCR2A)
+	#define LEDMUX_OCR OCR2A
+	#define LEDMUX_TCNT TCNT2
+#elif defined(TCCR3A)
+	#define LEDMUX_OCR OCR3A
+	#define LEDMUX_TCNT TCNT3
+#else
+	#error "LedMux needs timer2 or timer3"
+#endif
+//the compare A vector belongs to tone(), the refresh is hooked there (toneTimerAttach)
+
+#define LEDMUX_MIN_TICKS 8//shortest on/off time (32us)
+
+static LedMux* refreshing=0;
+
+//next interrupt after ticks (counter restarted on the last match), but never
+//behind the counter when the push took longer (slow buses), or it would wrap
+static inline void nextRefresh(uint8_t ticks) {
+	uint8_t t=LEDMUX_TCNT+2;
+	LEDMUX_OCR=ticks>t?ticks:t;
+}
+
+//7 segment font (gfedcba)
+static const uint8_t PROGMEM hexFont[16]={
+	0x3F,0x06,0x5B,0x4F,0x66,0x6D,0x7D,0x07,0x7F,0x6F,0x77,0x7C,0x39,0x5E,0x79,0x71
+};
+
+LedMux::LedMux(char sp,char rp,uint8_t n,uint8_t f)
+	:segPort(sp),rowPort(rp),rows(n>LEDMUX_MAX_ROWS?LEDMUX_MAX_ROWS:n),flags(f),period(250),onTicks(250),cursor(0),row(0),lit(false) {
+	for(int r=0;r<LEDMUX_MAX_ROWS;r++) buffer[r]=0;
+}
+
+//segments and row select in one port update, once per branch
+void LedMux::push(uint8_t seg,uint8_t sel) {
+	*portOutputRegister(segPort)=flags&LEDMUX_SEG_LOW?~seg:seg;
+	*portOutputRegister(rowPort)=flags&LEDMUX_ROW_LOW?~sel:sel;
+	#ifdef USE_VIRTUAL_PINS
+		if (segPort>=VPA) vpins_out(segPort);
+		if (rowPort>=VPA && portBranch::getBranchId(rowPort)!=portBranch::getBranchId(segPort)) vpins_out(rowPort);
+	#endif
+}
+
+static void refreshISR() {
+	if (refreshing) refreshing->refresh();
+}
+
+//timer ticks are 4us (prescaler 64 at 16MHz), 8 bit compare on timer2
+//fails while a tone plays or when a port branch can not transfer from the interrupt (I2C)
+bool LedMux::begin(unsigned int rowHz) {
+	#ifdef USE_VIRTUAL_PINS
+		if ((segPort>=VPA && !vpins_isr_safe(segPort)) || (rowPort>=VPA && !vpins_isr_safe(rowPort))) return false;
+	#endif
+	if (refreshing!=this && !toneTimerAttach(refreshISR)) return false;
+	unsigned long t=F_CPU/64/rowHz;
+	period=t>255?255:t<16?16:t;
+	onTicks=period;
+	refreshing=this;
+	uint8_t oldSREG=SREG;
+	cli();
+	#if defined(TCCR2A)
+		TCCR2A=_BV(WGM21);//CTC
+		TCCR2B=_BV(CS22);//clk/64
+		OCR2A=period;
+		TCNT2=0;
+		TIFR2=_BV(OCF2A);
+		TIMSK2=_BV(OCIE2A);
+	#else
+		TCCR3A=0;
+		TCCR3B=_BV(WGM32)|_BV(CS31)|_BV(CS30);//CTC, clk/64
+		OCR3A=period;
+		TCNT3=0;
+		TIFR3=_BV(OCF3A);
+		TIMSK3=_BV(OCIE3A);
+	#endif
+	SREG=oldSREG;
+	return true;
+}
+
+//the timer goes back to PWM as after noTone()
+void LedMux::end() {
+	if (refreshing!=this) return;
+	toneTimerDetach();
+	refreshing=0;
+	push(0,0);
+}
+
+void LedMux::setBrightness(uint8_t b) {
+	unsigned int on=((unsigned int)period*b)/255;
+	if (b && on<LEDMUX_MIN_TICKS) on=LEDMUX_MIN_TICKS;
+	if (on>period-LEDMUX_MIN_TICKS) on=period;
+	onTicks=on;
+}
+
+void LedMux::clear() {
+	for(int r=0;r<rows;r++) buffer[r]=0;
+	cursor=0;
+}
+
+void LedMux::setPixel(uint8_t x,uint8_t y,bool on) {
+	if (y>=rows || x>7) return;
+	if (on) buffer[y]|=1<<x;
+	else buffer[y]&=~(1<<x);
+}
+
+void LedMux::setDigit(uint8_t pos,uint8_t value,bool dp) {
+	if (pos<rows) buffer[pos]=pgm_read_byte(hexFont+(value&15))|(dp?SEG_DP:0);
+}
+
+void LedMux::setCursor(uint8_t pos) {cursor=pos;}
+
+size_t LedMux::write(uint8_t c) {
+	uint8_t seg;
+	if (c=='\r') {cursor=0;return 1;}
+	if (c=='\n') return 1;
+	if (c=='.') {//goes on the previous digit
+		if (cursor && cursor<=rows) buffer[cursor-1]|=SEG_DP;
+		return 1;
+	}
+	if (c>='0' && c<='9') seg=pgm_read_byte(hexFont+c-'0');
+	else if (c>='a' && c<='f') seg=pgm_read_byte(hexFont+c-'a'+10);
+	else if (c>='A' && c<='F') seg=pgm_read_byte(hexFont+c-'A'+10);
+	else switch(c) {
+		case '-': seg=0x40;break;
+		case '_': seg=0x08;break;
+		case 'H': case 'h': seg=0x76;break;
+		case 'L': case 'l': seg=0x38;break;
+		case 'P': case 'p': seg=0x73;break;
+		case 'o': seg=0x5C;break;
+		case 'r': seg=0x50;break;
+		case 'u': seg=0x1C;break;
+		default: seg=0;break;
+	}
+	if (cursor>=rows) return 0;
+	buffer[cursor++]=seg;
+	return 1;
+}
+
+//lit phase: next row on for onTicks, dark phase: all rows off for the rest of the period
+void LedMux::refresh() {
+	uint8_t on=onTicks;
+	if (lit || !on) {
+		push(0,0);
+		lit=false;
+		if (on<period) {
+			nextRefresh(period-on);
+			return;
+		}
+		//full brightness was set during the lit phase, go on with the next row
+	}
+	if (++row>=rows) row=0;
+	push(buffer[row],1<<row);
+	lit=on<period;
+	nextRefresh(on);
+}
+
@@ -0,0 +1,52 @@
+#ifndef LED_MUX_DEF
+#define LED_MUX_DEF
+
+	#include <Arduino.h>
+
+	//multiplexed LEDs (7 segment digits, LED matrices) on ports, usually a 595 chain (SPIBranch)
+	//one port holds the segments/columns of a row, another selects the row
+	//rows are refreshed from the tone() timer interrupt (timer2, timer3 on the Leonardo), borrowed
+	//with toneTimerAttach(): begin() fails while a tone plays and tone() plays nothing (returns 0)
+	//while the display runs. The vector stays in the core, defining TIMER2_COMPA_vect again in a
+	//sketch or library is a multiple definition link error.
+	//timer2 runs in CTC mode meanwhile, PWM (analogWrite) is lost on pins 3 and 11 (9 and 10 on the
+	//Mega, pin 5 with timer3 on the Leonardo) until end()
+	//each row is one port update (one chain push when both ports are on the same branch)
+	//the branch transfers are done from the interrupt, so begin() fails on branches that can not
+	//transfer there (I2C), and that bus must not be used by other code while the display runs
+	//(or only with interrupts disabled)
+
+	#define LEDMUX_SEG_LOW 1//segments/columns are on when low (common anode)
+	#define LEDMUX_ROW_LOW 2//row is selected when low (common cathode digits)
+	#define LEDMUX_MAX_ROWS 8
+
+	//7 segment bits: a=bit0 ... g=bit6, dp=bit7
+	#define SEG_DP 0x80
+
+	class LedMux:public Print {
+	protected:
+		char segPort,rowPort;
+		uint8_t rows,flags;
+		uint8_t period;//timer ticks per row
+		volatile uint8_t onTicks;//timer ticks a row is lit, from brightness
+		uint8_t cursor;//print position
+		void push(uint8_t seg,uint8_t sel);
+	public:
+		volatile uint8_t buffer[LEDMUX_MAX_ROWS];//segments/columns of each row, bit set is lit
+		uint8_t row;//row being shown (ISR)
+		bool lit;//ISR phase
+		LedMux(char segPort,char rowPort,uint8_t rows,uint8_t flags=0);
+		bool begin(unsigned int rowHz=1000);//starts the refresh, call after the media is started
+		void end();
+		void setBrightness(uint8_t b);//0-255, on time of each row
+		void clear();
+		inline void setRow(uint8_t r,uint8_t bits) {if (r<rows) buffer[r]=bits;}
+		void setPixel(uint8_t x,uint8_t y,bool on);
+		void setDigit(uint8_t pos,uint8_t value,bool dp=false);//hex digit on a 7 segment position
+		void setCursor(uint8_t pos);
+		virtual size_t write(uint8_t c);//7 segment text: digits, A-F, some letters, '-', '.', ' ' ('\r' goes home)
+		void refresh();//timer interrupt
+		using Print::write;
+	};
+
+#endif
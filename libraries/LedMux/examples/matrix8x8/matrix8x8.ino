@@ -0,0 +1,31 @@
+/*
+LedMux - 8x8 LED matrix on a 595 chain
+  first 595 drives the columns, second one the rows
+  a dot bounces around, the matrix is refreshed from a timer interrupt
+*/
+
+#include <SPI.h>
+#include <VPinsSPI.h>
+#include <LedMux.h>
+
+#define STCP 9//latch pin
+SPIBranch spi(SPI,STCP,VP_FREE,2);
+
+LedMux matrix(spi.localPort,spi.localPort+1,8);
+
+int x=0,y=3,dx=1,dy=1;
+
+void setup() {
+  SPI.begin();
+  matrix.begin(1000);//rows per second, 125 frames per second
+}
+
+void loop() {
+  matrix.setPixel(x,y,false);
+  if (x+dx<0 || x+dx>7) dx=-dx;
+  if (y+dy<0 || y+dy>7) dy=-dy;
+  x+=dx;
+  y+=dy;
+  matrix.setPixel(x,y,true);
+  delay(80);
+}
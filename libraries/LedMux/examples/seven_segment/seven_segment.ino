@@ -0,0 +1,26 @@
+/*
+LedMux - 8 digit 7 segment display on a 595 chain
+  first 595 drives the segments (a..g,dp), second one selects the digit (common cathode, low selects)
+  the display refreshes itself from a timer interrupt, loop only changes the buffer
+*/
+
+#include <SPI.h>
+#include <VPinsSPI.h>
+#include <LedMux.h>
+
+#define STCP 9//latch pin
+SPIBranch spi(SPI,STCP,VP_FREE,2);//segments on first port, digits on second
+
+LedMux display(spi.localPort,spi.localPort+1,8,LEDMUX_ROW_LOW);
+
+void setup() {
+  SPI.begin();
+  display.begin();
+  display.setBrightness(128);
+}
+
+void loop() {
+  display.clear();
+  display.print(millis()/100.0,1);//seconds with one decimal
+  delay(100);
+}
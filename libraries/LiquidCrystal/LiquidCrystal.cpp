@@ -1,10 +1,15 @@
 #include "LiquidCrystal.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
 #include "Arduino.h"
 
+// instruction execution times (us)
+#define LCD_EXEC_TIME 50 // 37us at 270kHz, margin for slower oscillators
+#define LCD_HOME_TIME 2000 // clear and home, 1.52ms at 270kHz
+
 // When the display powers up, it is configured as follows:
 //
 // 1. Display clear
@@ -73,7 +78,31 @@ void LiquidCrystal::init(uint8_t fourbitmode, uint8_t rs, uint8_t rw, uint8_t en
     pinMode(_rw_pin, OUTPUT);
   }
   pinMode(_enable_pin, OUTPUT);
+
+  _port = 0;
+#ifdef USE_VIRTUAL_PINS
+  // 4 data pins, RS, EN and RW fit one port, 8 bit mode does not
+  if (fourbitmode && _rs_pin >= NUM_DIGITAL_PINS) {
+    uint8_t port = digitalPinToPort(_rs_pin);
+    bool same = digitalPinToPort(_enable_pin) == port
+      && (_rw_pin == 255 || digitalPinToPort(_rw_pin) == port);
+    for (int i = 0; i < 4; i++)
+      same = same && _data_pins[i] >= NUM_DIGITAL_PINS && digitalPinToPort(_data_pins[i]) == port;
+    if (same && port != NOT_A_PORT) {
+      _port = port;
+      _rs_mask = digitalPinToBitMask(_rs_pin);
+      _rw_mask = _rw_pin == 255 ? 0 : digitalPinToBitMask(_rw_pin);
+      _enable_mask = digitalPinToBitMask(_enable_pin);
+      for (int i = 0; i < 4; i++)
+        _data_masks[i] = digitalPinToBitMask(_data_pins[i]);
+    }
+  }
+#endif
   
+  _fb = 0;
+  _ddram = 0xFF;
+  _busy_time = 0;
+
   if (fourbitmode)
     _displayfunction = LCD_4BITMODE | LCD_1LINE | LCD_5x8DOTS;
   else 
@@ -83,11 +112,14 @@ void LiquidCrystal::init(uint8_t fourbitmode, uint8_t rs, uint8_t rw, uint8_t en
 }
 
 void LiquidCrystal::begin(uint8_t cols, uint8_t lines, uint8_t dotsize) {
+  noFrameBuffer(); // sized for the previous geometry
+  _initialized = 0; // no busy flag until the function set is done
   if (lines > 1) {
     _displayfunction |= LCD_2LINE;
   }
   _numlines = lines;
   _currline = 0;
+  _numcols = cols;
 
   // for some 1 line displays you can select a 10 pixel high font
   if ((dotsize != 0) && (lines == 1)) {
@@ -98,6 +130,9 @@ void LiquidCrystal::begin(uint8_t cols, uint8_t lines, uint8_t dotsize) {
   // according to datasheet, we need at least 40ms after power rises above 2.7V
   // before sending commands. Arduino can turn on way befer 4.5V so we'll wait 50
   delayMicroseconds(50000); 
+#ifdef USE_VIRTUAL_PINS
+  if (_port) portInit();
+#endif
   // Now we pull both RS and R/W low to begin commands
   digitalWrite(_rs_pin, LOW);
   digitalWrite(_enable_pin, LOW);
@@ -124,6 +159,7 @@ void LiquidCrystal::begin(uint8_t cols, uint8_t lines, uint8_t dotsize) {
 
     // finally, set to 4-bit interface
     write4bits(0x02); 
+    delayMicroseconds(100);
   } else {
     // this is according to the hitachi HD44780 datasheet
     // page 45 figure 23
@@ -142,6 +178,7 @@ void LiquidCrystal::begin(uint8_t cols, uint8_t lines, uint8_t dotsize) {
 
   // finally, set # lines, font size, etc.
   command(LCD_FUNCTIONSET | _displayfunction);  
+  _initialized = 1;
 
   // turn the display on with no cursor or blinking default
   _displaycontrol = LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF;  
@@ -160,22 +197,42 @@ void LiquidCrystal::begin(uint8_t cols, uint8_t lines, uint8_t dotsize) {
 /********** high level commands, for the user! */
 void LiquidCrystal::clear()
 {
+  if (_fb) {
+    for (uint8_t r = 0; r < _numlines; r++)
+      for (uint8_t c = 0; c < _numcols; c++) {
+        _fbcol = c;
+        _fbrow = r;
+        write(' ');
+      }
+    _fbcol = _fbrow = 0;
+    return;
+  }
   command(LCD_CLEARDISPLAY);  // clear display, set cursor position to zero
-  delayMicroseconds(2000);  // this command takes a long time!
+  _busy_time = LCD_HOME_TIME;  // this command takes a long time!
 }
 
 void LiquidCrystal::home()
 {
+  if (_fb) {
+    _fbcol = _fbrow = 0;
+    return;
+  }
   command(LCD_RETURNHOME);  // set cursor position to zero
-  delayMicroseconds(2000);  // this command takes a long time!
+  _busy_time = LCD_HOME_TIME;  // this command takes a long time!
 }
 
+static const uint8_t row_offsets[] = { 0x00, 0x40, 0x14, 0x54 };
+
 void LiquidCrystal::setCursor(uint8_t col, uint8_t row)
 {
-  int row_offsets[] = { 0x00, 0x40, 0x14, 0x54 };
   if ( row >= _numlines ) {
     row = _numlines-1;    // we count rows starting w/0
   }
+  if (_fb) {
+    _fbcol = col;
+    _fbrow = row;
+    return;
+  }
   
   command(LCD_SETDDRAMADDR | (col + row_offsets[row]));
 }
@@ -248,7 +305,7 @@ void LiquidCrystal::createChar(uint8_t location, uint8_t charmap[]) {
   location &= 0x7; // we only have 8 locations 0-7
   command(LCD_SETCGRAMADDR | (location << 3));
   for (int i=0; i<8; i++) {
-    write(charmap[i]);
+    send(charmap[i], HIGH); // not write(), it would go to the frame buffer
   }
 }
 
@@ -256,17 +313,147 @@ void LiquidCrystal::createChar(uint8_t location, uint8_t charmap[]) {
 
 inline void LiquidCrystal::command(uint8_t value) {
   send(value, LOW);
+  _ddram = 0xFF; // could have moved the address counter (or pointed it to CGRAM)
 }
 
 inline size_t LiquidCrystal::write(uint8_t value) {
+  if (_fb) {
+    // text past the end of the row is dropped
+    if (_fbcol >= _numcols) return 0;
+    uint16_t i = _fbrow * _numcols + _fbcol;
+    if (_displaymode & LCD_ENTRYLEFT) _fbcol++; else _fbcol--; // wraps to 0xFF on the left edge
+    if (_fb[i] != value) {
+      _fb[i] = value;
+      _fb[_numcols * _numlines + (i >> 3)] |= 1 << (i & 7);
+    }
+    return 1;
+  }
   send(value, HIGH);
   return 1; // assume sucess
 }
 
+/*********** frame buffer */
+
+bool LiquidCrystal::frameBuffer() {
+  if (_fb) return true;
+  uint16_t n = _numcols * _numlines;
+  _fb = (uint8_t*)malloc(n + ((n + 7) >> 3));
+  if (!_fb) return false;
+  // display content is unknown, start with spaces all dirty
+  memset(_fb, ' ', n);
+  memset(_fb + n, 0xFF, n >> 3);
+  if (n & 7) _fb[n + (n >> 3)] = (1 << (n & 7)) - 1; // no stray bits past the last cell
+  _fbcol = _fbrow = 0;
+  _ddram = 0xFF; // writes done without the buffer moved the address counter
+  return true;
+}
+
+void LiquidCrystal::noFrameBuffer() {
+  free(_fb);
+  _fb = 0;
+}
+
+void LiquidCrystal::setAddress(uint8_t addr) {
+  if (_ddram == addr) return;
+  command(LCD_SETDDRAMADDR | addr);
+  _ddram = addr;
+}
+
+// send dirty cells row by row, a new address is only sent when the
+// display counter is not already there (runs of changes cost one command)
+bool LiquidCrystal::update(unsigned long budget) {
+  if (!_fb) return true;
+  unsigned long start = micros();
+  uint16_t n = _numcols * _numlines;
+  uint8_t *dirty = _fb + n;
+  uint16_t k = 0, bytes = (n + 7) >> 3;
+  // nothing to send, not even the entry mode switch
+  while (k < bytes && !dirty[k]) k++;
+  if (k == bytes) return true;
+  uint8_t mode = _displaymode;
+  bool done = true;
+  // buffer is laid out left to right, without display shift
+  if (mode != (LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT))
+    command(LCD_ENTRYMODESET | LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT);
+  for (uint8_t r = 0; r < _numlines && done; r++) {
+    for (uint8_t c = 0; c < _numcols; c++) {
+      uint16_t i = r * _numcols + c;
+      if (!(dirty[i >> 3] & (1 << (i & 7)))) continue;
+      if (budget && micros() - start >= budget) {
+        done = false;
+        break;
+      }
+      setAddress(row_offsets[r] + c);
+      send(_fb[i], HIGH);
+      _ddram++;
+      dirty[i >> 3] &= ~(1 << (i & 7));
+    }
+  }
+  if (mode != (LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT))
+    command(LCD_ENTRYMODESET | mode);
+  return done;
+}
+
 /************ low level data pushing commands **********/
 
 // write either command or data, with automatic 4/8-bit selection
+// the wait for the previous instruction is done here, so time spent
+// by the caller (or on the bus) since then is not waited again
 void LiquidCrystal::send(uint8_t value, uint8_t mode) {
+  waitReady();
+#ifdef USE_VIRTUAL_PINS
+  if (_port)
+    portSend(value, mode);
+  else
+#endif
+    pinSend(value, mode);
+  _busy_start = micros();
+  _busy_time = LCD_EXEC_TIME;
+}
+
+// wait for the remaining execution time of the last instruction, or poll
+// the busy flag when RW is wired. Polling is capped at the nominal time.
+// Over a virtual port a poll costs several bus transfers, more than a normal
+// instruction takes, so there it is only used for the long ones.
+void LiquidCrystal::waitReady() {
+  unsigned long elapsed = micros() - _busy_start;
+  if (elapsed >= _busy_time) return;
+  if (_rw_pin != 255 && _initialized && (!_port || _busy_time - elapsed >= 1000)) {
+    while (readBusy() && micros() - _busy_start < _busy_time);
+  } else {
+    delayMicroseconds(_busy_time - elapsed);
+  }
+}
+
+// read D7 (busy flag), in 4 bit mode the second nibble must be clocked too
+// the data bits are written high: quasi-bidirectional expanders (PCF8574) have
+// no input mode and a low output would hide the flag, native pins get pull-ups
+uint8_t LiquidCrystal::readBusy() {
+  uint8_t n = (_displayfunction & LCD_8BITMODE) ? 8 : 4;
+  for (int i = 0; i < n; i++) {
+    pinMode(_data_pins[i], INPUT);
+    digitalWrite(_data_pins[i], HIGH);
+  }
+  digitalWrite(_rs_pin, LOW);
+  digitalWrite(_rw_pin, HIGH);
+  digitalWrite(_enable_pin, HIGH);
+  delayMicroseconds(1);    // data valid 360ns after enable
+  uint8_t busy = digitalRead(_data_pins[n - 1]);
+  digitalWrite(_enable_pin, LOW);
+  if (n == 4) {
+    delayMicroseconds(1);
+    digitalWrite(_enable_pin, HIGH);
+    delayMicroseconds(1);
+    digitalWrite(_enable_pin, LOW);
+  }
+  digitalWrite(_rw_pin, LOW);
+  for (int i = 0; i < n; i++) {
+    pinMode(_data_pins[i], OUTPUT);
+  }
+  return busy;
+}
+
+void LiquidCrystal::pinSend(uint8_t value, uint8_t mode) {
   digitalWrite(_rs_pin, mode);
 
   // if there is a RW pin indicated, set it low to Write
@@ -288,10 +475,16 @@ void LiquidCrystal::pulseEnable(void) {
   digitalWrite(_enable_pin, HIGH);
   delayMicroseconds(1);    // enable pulse must be >450ns
   digitalWrite(_enable_pin, LOW);
-  delayMicroseconds(100);   // commands need > 37us to settle
+  delayMicroseconds(1);    // enable cycle must be >1us, execution wait is in send()
 }
 
 void LiquidCrystal::write4bits(uint8_t value) {
+#ifdef USE_VIRTUAL_PINS
+  if (_port) {
+    portNibble(value);
+    return;
+  }
+#endif
   for (int i = 0; i < 4; i++) {
     pinMode(_data_pins[i], OUTPUT);
     digitalWrite(_data_pins[i], (value >> i) & 0x01);
@@ -308,3 +501,51 @@ void LiquidCrystal::write8bits(uint8_t value) {
   
   pulseEnable();
 }
+
+/************ single virtual port path **********/
+// every bus transaction is much longer than the HD44780 timings (450ns enable
+// pulse, 40ns address setup), so port states are sent back to back and the
+// expander latching them one by one does the pulse.
+
+#ifdef USE_VIRTUAL_PINS
+// pins were set as outputs at constructor time, before vpins_init cleared the
+// port data and before the bus was up, so do it again once for the whole port
+void LiquidCrystal::portInit() {
+  *portModeRegister(_port) |= _rs_mask | _rw_mask | _enable_mask
+    | _data_masks[0] | _data_masks[1] | _data_masks[2] | _data_masks[3];
+  vpins_mode(_port);
+}
+
+// port byte with the data pins set to the nibble, other pins of the port untouched
+uint8_t LiquidCrystal::portData(uint8_t value) {
+  uint8_t state = *portOutputRegister(_port)
+    & ~(_data_masks[0] | _data_masks[1] | _data_masks[2] | _data_masks[3]);
+  for (int i = 0; i < 4; i++)
+    if ((value >> i) & 0x01) state |= _data_masks[i];
+  return state;
+}
+
+void LiquidCrystal::portNibble(uint8_t value) {
+  uint8_t seq[2];
+  seq[1] = portData(value) & ~_enable_mask;
+  seq[0] = seq[1] | _enable_mask;
+  vpins_stream(_port, seq, 2);
+}
+
+// both nibbles in one transfer: [RS/RW setup] data+EN, data, data+EN, data
+void LiquidCrystal::portSend(uint8_t value, uint8_t mode) {
+  volatile uint8_t* out = portOutputRegister(_port);
+  uint8_t seq[5];
+  uint8_t n = 0;
+  uint8_t ctrl = (*out & ~(_rs_mask | _rw_mask | _enable_mask)) | (mode ? _rs_mask : 0);
+  if (ctrl != (*out & ~_enable_mask)) seq[n++] = ctrl; // RS must settle before EN rises
+  *out = ctrl;
+  seq[n + 1] = portData(value >> 4);
+  seq[n] = seq[n + 1] | _enable_mask;
+  n += 2;
+  seq[n + 1] = portData(value);
+  seq[n] = seq[n + 1] | _enable_mask;
+  n += 2;
+  vpins_stream(_port, seq, n);
+}
+#endif
@@ -81,26 +81,55 @@ public:
   void setCursor(uint8_t, uint8_t); 
   virtual size_t write(uint8_t);
   void command(uint8_t);
+
+  // shadow buffer mode: print/setCursor/clear/home work on RAM,
+  // update() sends only the changed cells (call after begin)
+  bool frameBuffer();
+  void noFrameBuffer();
+  bool update(unsigned long budget = 0); // budget in us (0: no limit), true when all sent
   
   using Print::write;
 private:
   void send(uint8_t, uint8_t);
+  void pinSend(uint8_t, uint8_t);
+  void waitReady();
+  uint8_t readBusy();
   void write4bits(uint8_t);
   void write8bits(uint8_t);
   void pulseEnable();
+  void setAddress(uint8_t addr);
+  void portInit();
+  void portSend(uint8_t value, uint8_t mode);
+  void portNibble(uint8_t value);
+  uint8_t portData(uint8_t value);
 
   uint8_t _rs_pin; // LOW: command.  HIGH: character.
   uint8_t _rw_pin; // LOW: write to LCD.  HIGH: read from LCD.
   uint8_t _enable_pin; // activated by a HIGH pulse.
   uint8_t _data_pins[8];
 
+  // all pins on one virtual port: whole nibbles go out as port states
+  uint8_t _port; // 0 if not on a single virtual port
+  uint8_t _rs_mask, _rw_mask, _enable_mask;
+  uint8_t _data_masks[4];
+
   uint8_t _displayfunction;
   uint8_t _displaycontrol;
   uint8_t _displaymode;
 
   uint8_t _initialized;
 
+  // last instruction sent at _busy_start (micros) and takes _busy_time us
+  unsigned long _busy_start;
+  unsigned int _busy_time;
+
   uint8_t _numlines,_currline;
+  uint8_t _numcols;
+
+  // frame buffer, _numcols*_numlines chars followed by one dirty bit per char
+  uint8_t *_fb;
+  uint8_t _fbcol, _fbrow;
+  uint8_t _ddram; // display address counter, 0xFF if unknown
 };
 
 #endif
@@ -1,21 +1,51 @@
 #include "Multiplexer.h"
 
+#define GRAY(i) ((i)^((i)>>1))
+#define MUX_SAMPLE_US 16//ADC sample and hold is done 1.5 ADC clocks (12us at 125kHz) after start
+
+static Multiplexer* scanning=0;
+extern bool multiplexer_adc_isr __attribute__((weak));//defined by MULTIPLEXER_ADC_ISR
+
 void Multiplexer::begin(uint8_t* selectors, uint8_t Z, uint8_t length){
+	selPort=digitalPinToPort(selectors[0]);
+	selMask=0;
 	for(uint8_t i=0;i<length;i++){
 		this->selectors[i]=selectors[i];
 		pinMode(selectors[i],OUTPUT);
+		if (digitalPinToPort(selectors[i])!=selPort) selPort=NOT_A_PORT;
+		selMask|=selBits[i]=digitalPinToBitMask(selectors[i]);
 	}
 	this->length=length;
 	this->pin_Z=Z;
 	pinMode(pin_Z,INPUT);
+	selected=0xFF;
+	sweeps=0;
 }
 
-void Multiplexer::selectPin(uint8_t num){
-	for(uint8_t i=0;i<length;i++){
-		//Serial.print(bitRead(num,i));
-		digitalWrite(selectors[i],bitRead(num,i));
+//all selector bits in one port update when they share a port,
+//otherwise only the pins that change (one on Gray steps)
+void Multiplexer::select(uint8_t num){
+	if (num==selected) return;
+	if (selPort!=NOT_A_PORT) {
+		uint8_t set=0;
+		for(uint8_t i=0;i<length;i++) if (bitRead(num,i)) set|=selBits[i];
+		volatile uint8_t *out=portOutputRegister(selPort);
+		uint8_t oldSREG=SREG;
+		cli();
+		*out=(*out&~selMask)|set;
+		SREG=oldSREG;
+		#ifdef USE_VIRTUAL_PINS
+			if (selectors[0]>=NUM_DIGITAL_PINS) vpins_out(selPort);
+		#endif
+	} else {
+		for(uint8_t i=0;i<length;i++)
+			if (selected==0xFF || bitRead(num^selected,i)) digitalWrite(selectors[i],bitRead(num,i));
 	}
-	//Serial.println("");
+	selected=num;
+}
+
+void Multiplexer::selectPin(uint8_t num){
+	select(num);
 }
 
 int Multiplexer::getAnalogValue(){
@@ -27,11 +57,92 @@ bool Multiplexer::getDigitalValue(){
 }
 
 int Multiplexer::getAnalogValueAt(uint8_t num){
+	if (scanning==this) return getCachedValueAt(num);
 	selectPin(num);
 	return getAnalogValue();
 }
 
 bool Multiplexer::getDigitalValueAt(uint8_t num){
+	if (scanning==this) stopScan();//selectors are needed
 	selectPin(num);
 	return getDigitalValue();
 }
+
+int Multiplexer::getCachedValueAt(uint8_t num){
+	uint8_t oldSREG=SREG;
+	cli();
+	int v=values[num&15];
+	SREG=oldSREG;
+	return v;
+}
+
+bool Multiplexer::startScan(){
+	if (!&multiplexer_adc_isr) return false;//no handler, the interrupt would reset the board
+	if (scanning) scanning->stopScan();
+	//first sweep is blocking so the cache is valid at once,
+	//analogRead also sets the ADC channel and reference for the conversions below
+	for(uint8_t i=0;i<(1<<length);i++) {
+		select(GRAY(i));
+		values[GRAY(i)]=analogRead(pin_Z);
+	}
+	step=0;
+	select(GRAY(0));
+	scanning=this;
+	converting=true;
+	started=micros();
+	ADCSRA|=_BV(ADIF)|_BV(ADIE)|_BV(ADSC);
+	return true;
+}
+
+void Multiplexer::stopScan(){
+	if (scanning!=this) return;
+	ADCSRA&=~_BV(ADIE);
+	while(bit_is_set(ADCSRA,ADSC));
+	scanning=0;
+	converting=false;
+}
+
+//ADC interrupt: store the sample, then start the next one if its channel is already selected.
+//native selectors are switched here, virtual ones by scan() while the conversion runs
+void Multiplexer::adcDone(){
+	uint8_t low=ADCL;
+	values[GRAY(step)]=(ADCH<<8)|low;
+	uint8_t next=(step+1)&((1<<length)-1);
+	if (!next) sweeps++;
+	#ifdef USE_VIRTUAL_PINS
+		if (selectors[0]>=NUM_DIGITAL_PINS && selected!=GRAY(next)) {
+			step=next;
+			converting=false;
+			return;
+		}
+	#endif
+	select(GRAY(next));
+	step=next;
+	started=micros();
+	ADCSRA|=_BV(ADSC);
+}
+
+void Multiplexer::scan(){
+	if (scanning!=this) return;
+	uint8_t oldSREG=SREG;
+	cli();
+	bool conv=converting;
+	uint8_t st=step;
+	unsigned long t=started;//4 bytes, the ISR could change it between them
+	SREG=oldSREG;
+	if (!conv) {//selector was not ready when the conversion ended
+		select(GRAY(st));
+		cli();
+		converting=true;
+		started=micros();
+		ADCSRA|=_BV(ADSC);
+		SREG=oldSREG;
+	} else if (selected==GRAY(st) && micros()-t>=MUX_SAMPLE_US) {
+		//sample taken, move the selectors to the next channel during the conversion
+		select(GRAY((st+1)&((1<<length)-1)));
+	}
+}
+
+void Multiplexer::adcInterrupt(){
+	if (scanning) scanning->adcDone();
+}
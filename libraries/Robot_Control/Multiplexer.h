@@ -7,6 +7,15 @@
 #include "WProgram.h"
 #endif
 
+//background scan: channels are walked in Gray code order (one selector bit changes per step)
+//and converted with the ADC interrupt into a cache, getAnalogValueAt() then returns the cache.
+//The scan owns the ADC, call stopScan() before using analogRead() on other pins.
+//The library does not define the ADC interrupt, so sketches with their own ADC_vect still link.
+//Sketches using the scan put MULTIPLEXER_ADC_ISR once at global scope, startScan() fails without it.
+#define MULTIPLEXER_ADC_ISR \
+	bool multiplexer_adc_isr=true; \
+	ISR(ADC_vect) {Multiplexer::adcInterrupt();}
+
 class Multiplexer{
 	public:
 		void begin(uint8_t* selectors, uint8_t Z, uint8_t length);
@@ -15,10 +24,26 @@ class Multiplexer{
 		int getAnalogValueAt(uint8_t num);
 		bool getDigitalValue();
 		bool getDigitalValueAt(uint8_t num);
+		bool startScan();//false if the sketch has no MULTIPLEXER_ADC_ISR
+		void stopScan();
+		void scan();//advances the scan when selectors are virtual pins (bus transfers are not done from the ISR)
+		int getCachedValueAt(uint8_t num);
+		volatile uint8_t sweeps;//full scans done, wraps
+		void adcDone();//ADC interrupt
+		static void adcInterrupt();//called by MULTIPLEXER_ADC_ISR
 	private:
+		void select(uint8_t num);
 		uint8_t selectors[4];
 		uint8_t pin_Z;
 		uint8_t length;
+		uint8_t selPort;//NOT_A_PORT if selectors are not on one port
+		uint8_t selBits[4];
+		uint8_t selMask;
+		volatile uint8_t selected;//channel on the selectors
+		volatile uint8_t step;//gray step being converted
+		volatile bool converting;
+		volatile unsigned long started;//micros of the last conversion start
+		volatile int values[16];
 };
 
 #endif
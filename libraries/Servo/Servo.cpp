@@ -70,13 +70,112 @@ uint8_t ServoCount = 0;                                     // the total number
 #define SERVO_MIN() (MIN_PULSE_WIDTH - this->min * 4)  // minimum value in uS for this servo
 #define SERVO_MAX() (MAX_PULSE_WIDTH - this->max * 4)  // maximum value in uS for this servo 
 
+#if defined(USE_VIRTUAL_PINS) && !defined(WIRING)
+#define VIRTUAL_SERVOS
+#define VSERVO_TIMER _timer1
+#define VSERVO_START usToTicks(16)   // rising edge, a bit after the frame restart
+#define VSERVO_MERGE usToTicks(8)    // falling edges closer than this go on the same port update
+#define VSERVO_IDLE 0xFF
+#define VSERVO_RISE 0xFE
+
+typedef struct {
+  uint8_t port;                      // NOT_A_PORT if not attached
+  uint8_t mask;
+  unsigned int ticks;
+} vservo_t;
+
+static vservo_t vservos[MAX_VIRTUAL_SERVOS];
+static uint8_t vorder[MAX_VIRTUAL_SERVOS];                  // attached virtual servos sorted by pulse width
+static uint8_t vcount;                                      // entries in vorder
+static uint8_t vservoCount = 0;                             // attached virtual servos
+static volatile bool vrebuild;                              // attach/detach changed, rebuild vorder
+static volatile uint8_t vnext = VSERVO_IDLE;                // next vorder entry to fall
+#endif
+
 /************ static functions common to all instances ***********************/
 
+#ifdef VIRTUAL_SERVOS
+// called at the frame restart, prepares the schedule and arms the rising edge
+static void vservo_frame()
+{
+  if (vrebuild) {
+    vrebuild = false;
+    vcount = 0;
+    for (uint8_t k = 0; k < MAX_VIRTUAL_SERVOS; k++)
+      if (vservos[k].port != NOT_A_PORT) vorder[vcount++] = k;
+  }
+  // insertion sort, the order rarely changes between frames so this is ~linear
+  for (uint8_t i = 1; i < vcount; i++) {
+    uint8_t k = vorder[i];
+    unsigned int t = vservos[k].ticks;
+    uint8_t j = i;
+    for (; j > 0 && vservos[vorder[j - 1]].ticks > t; j--) vorder[j] = vorder[j - 1];
+    vorder[j] = k;
+  }
+  if (!vcount) return;
+  vnext = VSERVO_RISE;
+  OCR1B = VSERVO_START;
+}
+
+// send the touched ports, once per branch (a branch transfer carries all its ports)
+static void vservo_push(uint8_t ports)
+{
+  uint8_t done = 0;
+  for (uint8_t p = 0; ports; p++, ports >>= 1) {
+    if (!(ports & 1)) continue;
+    char b = portBranch::getBranchId(VPA + p);
+    if (b != NOT_A_BRANCH) {
+      if (done & (1 << b)) continue;
+      done |= 1 << b;
+    }
+    vpins_out(VPA + p);
+  }
+}
+
+static void vservo_edge()
+{
+  if (vnext == VSERVO_IDLE) return;
+  for (;;) {
+    uint8_t ports = 0;
+    if (vnext == VSERVO_RISE) {
+      for (uint8_t i = 0; i < vcount; i++) {
+        vservo_t *v = &vservos[vorder[i]];
+        *portOutputRegister(v->port) |= v->mask;
+        ports |= 1 << (v->port - VPA);
+      }
+      vnext = 0;
+    } else {
+      // everything due now (or within the merge window) falls together
+      unsigned int now = TCNT1 - VSERVO_START;
+      while (vnext < vcount && vservos[vorder[vnext]].ticks <= now + VSERVO_MERGE) {
+        vservo_t *v = &vservos[vorder[vnext++]];
+        *portOutputRegister(v->port) &= ~v->mask;
+        ports |= 1 << (v->port - VPA);
+      }
+    }
+    vservo_push(ports);
+    if (vnext >= vcount) {
+      vnext = VSERVO_IDLE;
+      return;
+    }
+    unsigned int at = VSERVO_START + vservos[vorder[vnext]].ticks;
+    // the transfer may have taken us past the next edge, then go on without waiting
+    if ((int)(at - TCNT1) > (int)VSERVO_MERGE) {
+      OCR1B = at;
+      return;
+    }
+  }
+}
+#endif
+
 static inline void handle_interrupts(timer16_Sequence_t timer, volatile uint16_t *TCNTn, volatile uint16_t* OCRnA)
 {
-  if( Channel[timer] < 0 )
+  if( Channel[timer] < 0 ) {
     *TCNTn = 0; // channel set to -1 indicated that refresh interval completed so reset the timer 
-  else{
+#ifdef VIRTUAL_SERVOS
+    if (timer == VSERVO_TIMER) vservo_frame();
+#endif
+  } else{
     if( SERVO_INDEX(timer,Channel[timer]) < ServoCount && SERVO(timer,Channel[timer]).Pin.isActive == true )  
       digitalWrite( SERVO(timer,Channel[timer]).Pin.nbr,LOW); // pulse this channel low if activated   
   }
@@ -106,6 +205,13 @@ ISR(TIMER1_COMPA_vect)
 }
 #endif
 
+#ifdef VIRTUAL_SERVOS
+ISR(TIMER1_COMPB_vect) 
+{ 
+  vservo_edge(); 
+}
+#endif
+
 #if defined(_useTimer3)
 ISR(TIMER3_COMPA_vect) 
 { 
@@ -232,6 +338,10 @@ static void finISR(timer16_Sequence_t timer)
 static boolean isTimerActive(timer16_Sequence_t timer)
 {
   // returns true if any servo is active on this timer
+#ifdef VIRTUAL_SERVOS
+  if(timer == VSERVO_TIMER && vservoCount)
+    return true;
+#endif
   for(uint8_t channel=0; channel < SERVOS_PER_TIMER; channel++) {
     if(SERVO(timer,channel).Pin.isActive == true)
       return true;
@@ -240,6 +350,31 @@ static boolean isTimerActive(timer16_Sequence_t timer)
 }
 
 
+#ifdef VIRTUAL_SERVOS
+static void vservo_enable(bool on)
+{
+#if defined(__AVR_ATmega8__)|| defined(__AVR_ATmega128__)
+  if (on) { TIFR |= _BV(OCF1B); TIMSK |= _BV(OCIE1B); }
+  else TIMSK &= ~_BV(OCIE1B);
+#else
+  if (on) { TIFR1 |= _BV(OCF1B); TIMSK1 |= _BV(OCIE1B); }
+  else TIMSK1 &= ~_BV(OCIE1B);
+#endif
+}
+#endif
+
+// pulse width storage of a servo index, 0 if invalid
+static volatile unsigned int *servoTicks(uint8_t index)
+{
+#ifdef VIRTUAL_SERVOS
+  if (index != INVALID_SERVO && (index & VIRTUAL_SERVO))
+    return &vservos[index & ~VIRTUAL_SERVO].ticks;
+#endif
+  if (index < MAX_SERVOS)
+    return &servos[index].ticks;
+  return 0;
+}
+
 /****************** end of static functions ******************************/
 
 Servo::Servo()
@@ -259,6 +394,10 @@ uint8_t Servo::attach(int pin)
 
 uint8_t Servo::attach(int pin, int min, int max)
 {
+#ifdef VIRTUAL_SERVOS
+  if (pin >= NUM_DIGITAL_PINS || (this->servoIndex != INVALID_SERVO && (this->servoIndex & VIRTUAL_SERVO)))
+    return attachVirtual(pin, min, max);
+#endif
   if(this->servoIndex < MAX_SERVOS ) {
     pinMode( pin, OUTPUT) ;                                   // set servo pin to output
     servos[this->servoIndex].Pin.nbr = pin;  
@@ -274,8 +413,63 @@ uint8_t Servo::attach(int pin, int min, int max)
   return this->servoIndex ;
 }
 
+#ifdef VIRTUAL_SERVOS
+// virtual pin servos take a slot of their own (the native index, if any, is left unused)
+uint8_t Servo::attachVirtual(int pin, int min, int max)
+{
+  uint8_t k;
+  if (!vpins_isr_safe(digitalPinToPort(pin))) return INVALID_SERVO; // the frame is sent from the ISR
+  if (this->servoIndex != INVALID_SERVO && (this->servoIndex & VIRTUAL_SERVO)) {
+    k = this->servoIndex & ~VIRTUAL_SERVO;
+    if (pin < NUM_DIGITAL_PINS) return INVALID_SERVO; // can not move back to a native channel
+  } else {
+    for (k = 0; k < MAX_VIRTUAL_SERVOS && vservos[k].port != NOT_A_PORT; k++);
+    if (k == MAX_VIRTUAL_SERVOS) return INVALID_SERVO;
+    volatile unsigned int *ticks = servoTicks(this->servoIndex);
+    vservos[k].ticks = ticks ? *ticks : usToTicks(DEFAULT_PULSE_WIDTH); // keep a write() done before attach
+    this->servoIndex = VIRTUAL_SERVO | k;
+  }
+  pinMode(pin, OUTPUT);
+  this->min  = (MIN_PULSE_WIDTH - min)/4; //resolution of min/max is 4 uS
+  this->max  = (MAX_PULSE_WIDTH - max)/4; 
+  if (vservos[k].port == NOT_A_PORT) {
+    if (isTimerActive(VSERVO_TIMER) == false)
+      initISR(VSERVO_TIMER);
+    vservoCount++;
+    vservo_enable(true);
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  vservos[k].port = digitalPinToPort(pin);
+  vservos[k].mask = digitalPinToBitMask(pin);
+  vrebuild = true;
+  SREG = oldSREG;
+  return this->servoIndex;
+}
+#endif
+
 void Servo::detach()  
 {
+#ifdef VIRTUAL_SERVOS
+  if (this->servoIndex != INVALID_SERVO && (this->servoIndex & VIRTUAL_SERVO)) {
+    vservo_t *v = &vservos[this->servoIndex & ~VIRTUAL_SERVO];
+    if (v->port == NOT_A_PORT) return;
+    uint8_t port = v->port;
+    uint8_t oldSREG = SREG;
+    cli();
+    *portOutputRegister(port) &= ~v->mask; // could be detached in the middle of a pulse
+    v->port = NOT_A_PORT;
+    vrebuild = true;
+    SREG = oldSREG;
+    vpins_out(port);
+    if (--vservoCount == 0) {
+      vservo_enable(false);
+      if (isTimerActive(VSERVO_TIMER) == false)
+        finISR(VSERVO_TIMER);
+    }
+    return;
+  }
+#endif
   servos[this->servoIndex].Pin.isActive = false;  
   timer16_Sequence_t timer = SERVO_INDEX_TO_TIMER(servoIndex);
   if(isTimerActive(timer) == false) {
@@ -298,7 +492,7 @@ void Servo::writeMicroseconds(int value)
 {
   // calculate and store the values for the given channel
   byte channel = this->servoIndex;
-  if( (channel < MAX_SERVOS) )   // ensure channel is valid
+  if( servoTicks(channel) )   // ensure channel is valid
   {  
     if( value < SERVO_MIN() )          // ensure pulse width is valid
       value = SERVO_MIN();
@@ -310,7 +504,7 @@ void Servo::writeMicroseconds(int value)
 
     uint8_t oldSREG = SREG;
     cli();
-    servos[channel].ticks = value;  
+    *servoTicks(channel) = value;  
     SREG = oldSREG;   
   } 
 }
@@ -323,8 +517,8 @@ int Servo::read() // return the value as degrees
 int Servo::readMicroseconds()
 {
   unsigned int pulsewidth;
-  if( this->servoIndex != INVALID_SERVO )
-    pulsewidth = ticksToUs(servos[this->servoIndex].ticks)  + TRIM_DURATION ;   // 12 aug 2009
+  if( servoTicks(this->servoIndex) )
+    pulsewidth = ticksToUs(*servoTicks(this->servoIndex))  + TRIM_DURATION ;   // 12 aug 2009
   else 
     pulsewidth  = 0;
 
@@ -333,5 +527,9 @@ int Servo::readMicroseconds()
 
 bool Servo::attached()
 {
+#ifdef VIRTUAL_SERVOS
+  if (this->servoIndex != INVALID_SERVO && (this->servoIndex & VIRTUAL_SERVO))
+    return vservos[this->servoIndex & ~VIRTUAL_SERVO].port != NOT_A_PORT;
+#endif
   return servos[this->servoIndex].Pin.isActive ;
 }
@@ -26,6 +26,13 @@
   Timers are seized as needed in groups of 12 servos - 24 servos use two timers, 48 servos will use four.
   The sequence used to sieze timers is defined in timers.h
 
+  Servos attached to virtual pins do not use the channels above, they are pulsed all together
+  on timer1 compare B: rising at the start of each frame and falling in pulse width order,
+  with one port update (per branch) for every distinct falling time, up to MAX_VIRTUAL_SERVOS.
+  The branch transfers are done from the interrupt, so the bus must not be used by other
+  code while servos are attached there (or only with interrupts disabled). Branches that
+  can not transfer from an interrupt (I2C, network) are refused, attach returns INVALID_SERVO.
+
   The methods are:
 
    Servo - Class for manipulating servo motors connected to Arduino pins.
@@ -95,6 +102,13 @@ typedef enum { _timer1, _Nbr_16timers } timer16_Sequence_t ;
 
 #define INVALID_SERVO         255     // flag indicating an invalid servo index
 
+// servos on virtual pins, all share timer1 compare B. Each one takes 5 bytes of RAM even
+// when unused, and a sketch #define does not reach the library, so raise it here (up to 48)
+#ifndef MAX_VIRTUAL_SERVOS
+#define MAX_VIRTUAL_SERVOS      8
+#endif
+#define VIRTUAL_SERVO        0x40     // servo index flag for virtual pin servos
+
 typedef struct  {
   uint8_t nbr        :6 ;             // a pin number from 0 to 63
   uint8_t isActive   :1 ;             // true if this channel is enabled, pin not pulsed if false 
@@ -118,6 +132,7 @@ public:
   int readMicroseconds();            // returns current pulse width in microseconds for this servo (was read_us() in first release)
   bool attached();                   // return true if this servo is attached, otherwise false 
 private:
+   uint8_t attachVirtual(int pin, int min, int max);
    uint8_t servoIndex;               // index into the channel data for this servo
    int8_t min;                       // minimum is this value times 4 added to MIN_PULSE_WIDTH    
    int8_t max;                       // maximum is this value times 4 added to MAX_PULSE_WIDTH   
@@ -0,0 +1,39 @@
+/* VirtualSweep
+ 8 servos on a 74HC595 (virtual pins)
+ All servos rise together at the start of each 20ms frame and fall in
+ pulse width order, one SPI update for each distinct falling time.
+ Do not use the SPI bus from other code while the servos are attached.
+ For more servos (up to 48) chain more 595s and raise MAX_VIRTUAL_SERVOS
+ in Servo.h.
+
+ This example code is in the public domain.
+*/ 
+
+#include <SPI.h>
+#include <VPinsSPI.h>
+#include <Servo.h> 
+
+#define STCP 9//595 latch pin
+SPIBranch spi(SPI,STCP,VP_FREE,1);//8 virtual pins
+
+#define NSERVOS 8
+Servo servos[NSERVOS];
+ 
+void setup() 
+{ 
+  SPI.begin();
+  for(int n = 0; n < NSERVOS; n++)
+    servos[n].attach(spi.pin(n));
+} 
+ 
+void loop() 
+{ 
+  // a wave running along the servos
+  for(int pos = 0; pos < 360; pos += 2) {
+    for(int n = 0; n < NSERVOS; n++) {
+      int a = (pos + n * 11) % 360;
+      servos[n].write(a < 180 ? a : 360 - a);
+    }
+    delay(20);
+  }
+} 
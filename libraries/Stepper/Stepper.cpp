@@ -48,6 +48,12 @@ http://www.arduino.cc/en/Tutorial/Stepper
 #include "Arduino.h"
 #include "Stepper.h"
 
+Stepper *Stepper::first = 0;
+
+// coil patterns, bit 0 is motor_pin_1 (see sequences above)
+static const uint8_t two_wire_steps[4] = {0b10, 0b11, 0b01, 0b00};
+static const uint8_t four_wire_steps[4] = {0b0101, 0b0110, 0b1010, 0b1001};
+
 /*
  * two-wire constructor.
  * Sets which wires should control the motor.
@@ -74,6 +80,8 @@ Stepper::Stepper(int number_of_steps, int motor_pin_1, int motor_pin_2)
   
   // pin_count is used by the stepMotor() method:
   this->pin_count = 2;
+
+  portSetup();
 }
 
 
@@ -104,6 +112,47 @@ Stepper::Stepper(int number_of_steps, int motor_pin_1, int motor_pin_2, int moto
 
   // pin_count is used by the stepMotor() method:  
   this->pin_count = 4;  
+
+  portSetup();
+}
+
+/*
+ * common setup of the port write and the non blocking engine
+ */
+void Stepper::portSetup()
+{
+  int pins[4] = {this->motor_pin_1, this->motor_pin_2};
+  if (this->pin_count == 4) {
+    pins[2] = this->motor_pin_3;
+    pins[3] = this->motor_pin_4;
+  }
+  this->coil_port = digitalPinToPort(pins[0]);
+  for (int i = 0; i < this->pin_count; i++) {
+    if (digitalPinToPort(pins[i]) != this->coil_port) this->coil_port = NOT_A_PORT;
+    this->coil_mask[i] = digitalPinToBitMask(pins[i]);
+  }
+
+  this->position = 0;
+  this->target = 0;
+  this->accel_n = 0;
+  this->acceleration = 0;
+  this->c0 = 0;
+  this->cn = 0;
+  this->step_interval = 0;
+  this->last_step_us = 0;
+  setMaxSpeed(1);
+
+  this->next = first;
+  first = this;
+}
+
+Stepper::~Stepper()
+{
+  for (Stepper **s = &first; *s; s = &(*s)->next)
+    if (*s == this) {
+      *s = this->next;
+      break;
+    }
 }
 
 /*
@@ -134,33 +183,193 @@ void Stepper::step(int steps_to_move)
   if (millis() - this->last_step_time >= this->step_delay) {
       // get the timeStamp of when you stepped:
       this->last_step_time = millis();
-      // increment or decrement the step number,
-      // depending on direction:
-      if (this->direction == 1) {
-        this->step_number++;
-        if (this->step_number == this->number_of_steps) {
-          this->step_number = 0;
-        }
-      } 
-      else { 
-        if (this->step_number == 0) {
-          this->step_number = this->number_of_steps;
-        }
-        this->step_number--;
-      }
       // decrement the steps left:
       steps_left--;
-      // step the motor to step number 0, 1, 2, or 3:
-      stepMotor(this->step_number % 4);
+      advance();
     }
   }
 }
 
+/*
+ * One step in this->direction
+ */
+void Stepper::advance()
+{
+  // increment or decrement the step number,
+  // depending on direction:
+  if (this->direction == 1) {
+    this->step_number++;
+    if (this->step_number == this->number_of_steps) {
+      this->step_number = 0;
+    }
+    this->position++;
+  } 
+  else { 
+    if (this->step_number == 0) {
+      this->step_number = this->number_of_steps;
+    }
+    this->step_number--;
+    this->position--;
+  }
+  // step the motor to step number 0, 1, 2, or 3:
+  stepMotor(this->step_number % 4);
+}
+
+/*
+  Non blocking engine, trapezoidal ramps computed per step with
+  c(n) = c(n-1) - 2*c(n-1)/(4n+1)  (D. Austin, "Generate stepper-motor speed
+  profiles in real time"), no float math after setAcceleration().
+*/
+void Stepper::setMaxSpeed(long stepsPerSecond)
+{
+  if (stepsPerSecond < 1) stepsPerSecond = 1;
+  this->cmin = (1000000UL << 8) / stepsPerSecond;
+  if (this->acceleration == 0) this->cn = this->cmin;
+}
+
+void Stepper::setAcceleration(long stepsPerSecondSquared)
+{
+  this->acceleration = stepsPerSecondSquared;
+  if (stepsPerSecondSquared <= 0) {
+    this->acceleration = 0;
+    this->cn = this->cmin;
+    return;
+  }
+  // first step interval, 0.676 corrects the error of the approximation at n=1
+  this->c0 = 0.676 * sqrt(2.0 / stepsPerSecondSquared) * 1000000.0 * 256.0;
+}
+
+void Stepper::moveTo(long absolute)
+{
+  if (this->target == absolute) return;
+  this->target = absolute;
+  computeNewSpeed();
+}
+
+void Stepper::move(long relative)
+{
+  moveTo(this->position + relative);
+}
+
+void Stepper::stop()
+{
+  if (this->step_interval == 0) return;
+  long stop_steps = 0;
+  if (this->acceleration) {
+    long speed = 1000000L / this->step_interval;
+    stop_steps = speed * speed / (2 * this->acceleration);
+  }
+  moveTo(this->position + (this->direction == 1 ? stop_steps : -stop_steps));
+}
+
+long Stepper::distanceToGo()
+{
+  return this->target - this->position;
+}
+
+long Stepper::currentPosition()
+{
+  return this->position;
+}
+
+void Stepper::setCurrentPosition(long position)
+{
+  this->position = this->target = position;
+  this->step_interval = 0;
+  this->accel_n = 0;
+}
+
+bool Stepper::isRunning()
+{
+  return this->step_interval != 0 || this->target != this->position;
+}
+
+// interval for the next step, called after every step
+void Stepper::computeNewSpeed()
+{
+  long distance = this->target - this->position;
+  if (this->acceleration == 0) {
+    // constant speed, start and stop at once
+    this->accel_n = 0;
+    this->cn = this->cmin;
+    this->step_interval = distance ? this->cmin >> 8 : 0;
+    if (distance) this->direction = distance > 0;
+    return;
+  }
+
+  // steps needed to stop from the current speed: v^2/(2a)
+  long speed = this->step_interval ? 1000000L / this->step_interval : 0;
+  long stop_steps = speed * speed / (2 * this->acceleration);
+
+  if (distance == 0 && stop_steps <= 1) {
+    this->step_interval = 0;
+    this->accel_n = 0;
+    return;
+  }
+
+  bool forward = distance > 0;
+  long togo = forward ? distance : -distance;
+  if (this->accel_n > 0) {
+    // slow down if we would overshoot or are going the wrong way
+    if (stop_steps >= togo || (this->direction == 1) != forward) this->accel_n = -stop_steps;
+  } else if (this->accel_n < 0) {
+    // speed up again if there is room and we go the right way
+    if (stop_steps < togo && (this->direction == 1) == forward) this->accel_n = -this->accel_n;
+  }
+
+  if (this->accel_n == 0) {
+    // a high acceleration can give a first step faster than the max speed
+    this->cn = this->c0 < this->cmin ? this->cmin : this->c0;
+    this->direction = forward;
+  } else {
+    this->cn -= (long)(this->cn * 2) / (4 * this->accel_n + 1);
+    if (this->cn < this->cmin) this->cn = this->cmin;
+  }
+  this->accel_n++;
+  this->step_interval = this->cn >> 8;
+  if (this->step_interval == 0) this->step_interval = 1;
+}
+
+bool Stepper::run()
+{
+  if (this->step_interval == 0) return false;
+  unsigned long now = micros();
+  if (now - this->last_step_us >= this->step_interval) {
+    this->last_step_us = now;
+    advance();
+    computeNewSpeed();
+  }
+  return isRunning();
+}
+
+void Stepper::runAll()
+{
+  for (Stepper *s = first; s; s = s->next) s->run();
+}
+
 /*
  * Moves the motor forward or backwards.
  */
 void Stepper::stepMotor(int thisStep)
 {
+  if (this->coil_port != NOT_A_PORT) {
+    // whole pattern at once, no torn coil states (and one bus write on virtual pins)
+    uint8_t coils = (this->pin_count == 2 ? two_wire_steps : four_wire_steps)[thisStep];
+    uint8_t set = 0, all = 0;
+    for (int i = 0; i < this->pin_count; i++) {
+      all |= this->coil_mask[i];
+      if (coils & (1 << i)) set |= this->coil_mask[i];
+    }
+    volatile uint8_t *out = portOutputRegister(this->coil_port);
+    uint8_t oldSREG = SREG;
+    cli();
+    *out = (*out & ~all) | set;
+    SREG = oldSREG;
+#ifdef USE_VIRTUAL_PINS
+    if (this->motor_pin_1 >= NUM_DIGITAL_PINS) vpins_out(this->coil_port);
+#endif
+    return;
+  }
   if (this->pin_count == 2) {
     switch (thisStep) {
       case 0: /* 01 */
@@ -51,6 +51,7 @@ class Stepper {
     // constructors:
     Stepper(int number_of_steps, int motor_pin_1, int motor_pin_2);
     Stepper(int number_of_steps, int motor_pin_1, int motor_pin_2, int motor_pin_3, int motor_pin_4);
+    ~Stepper();
 
     // speed setter method:
     void setSpeed(long whatSpeed);
@@ -58,10 +59,26 @@ class Stepper {
     // mover method:
     void step(int number_of_steps);
 
+    // non blocking moves, call run() (or runAll() for every motor) often:
+    void setMaxSpeed(long stepsPerSecond);
+    void setAcceleration(long stepsPerSecondSquared);  // 0: no ramps
+    void moveTo(long absolute);
+    void move(long relative);
+    void stop();          // decelerate to a stop as fast as allowed
+    bool run();           // steps if due, false when the move is done
+    bool isRunning();
+    long distanceToGo();
+    long currentPosition();
+    void setCurrentPosition(long position);
+    static void runAll();
+
     int version(void);
 
   private:
     void stepMotor(int this_step);
+    void advance();
+    void computeNewSpeed();
+    void portSetup();
     
     int direction;        // Direction of rotation
     int speed;          // Speed in RPMs
@@ -77,6 +94,24 @@ class Stepper {
     int motor_pin_4;
     
     long last_step_time;      // time stamp in ms of when the last step was taken
+
+    // coils on one port are written in one masked update
+    uint8_t coil_port;        // NOT_A_PORT if pins are on different ports
+    uint8_t coil_mask[4];
+
+    // non blocking engine, step intervals in us (cn is <<8 fixed point)
+    long position;
+    long target;
+    long accel_n;             // ramp step count, negative while decelerating
+    long acceleration;
+    unsigned long c0;
+    unsigned long cn;
+    unsigned long cmin;
+    unsigned long step_interval;  // 0: stopped
+    unsigned long last_step_us;
+
+    Stepper *next;            // all motors, for runAll()
+    static Stepper *first;
 };
 
 #endif
@@ -0,0 +1,37 @@
+/* 
+ Stepper Motor Control - several motors at once
+ 
+ Two motors move back and forth with acceleration, without blocking.
+ One is on pins 8 - 11, the other on the first 4 pins of a 74HC595
+ chain (virtual pins), each coil pattern is sent in one SPI update.
+ 
+ */
+
+#include <SPI.h>
+#include <VPinsSPI.h>
+#include <Stepper.h>
+
+const int stepsPerRevolution = 200;  // change this to fit the number of steps per revolution
+
+#define STCP 7//595 latch pin
+SPIBranch spi(SPI,STCP,VP_FREE,1);
+
+Stepper left(stepsPerRevolution, 8,9,10,11);
+Stepper right(stepsPerRevolution, spi.pin(0),spi.pin(1),spi.pin(2),spi.pin(3));
+
+void setup() {
+  SPI.begin();
+  left.setMaxSpeed(400);     // steps per second
+  left.setAcceleration(200); // steps per second per second
+  right.setMaxSpeed(200);
+  right.setAcceleration(400);
+  left.moveTo(stepsPerRevolution);
+  right.moveTo(-stepsPerRevolution);
+}
+
+void loop() {
+  // turn around at the ends
+  if (!left.isRunning()) left.moveTo(-left.currentPosition());
+  if (!right.isRunning()) right.moveTo(-right.currentPosition());
+  Stepper::runAll();
+}
@@ -0,0 +1,268 @@
+#include <Arduino.h>
+#include "VPinsBus.h"
+
+PortBurst::PortBurst(char p,uint8_t m)
+	:port(p),mask(m),sampleMask(0),openDrain(false),delayUs(0),count(0),samples(0) {}
+
+void PortBurst::put(uint8_t state,bool sample) {
+	if (count==VPBURST_LEN) play();//callers keep room, this only avoids overflow
+	if (!count) samples=0;//new burst
+	uint8_t b=1<<(count&7);
+	seq[count]=(*portOutputRegister(port)&~mask)|(state&mask);
+	if (sample) {
+		mark[count>>3]|=b;
+		samples++;
+	} else mark[count>>3]&=~b;
+	count++;
+}
+
+void PortBurst::play() {
+	uint8_t in[VPBURST_LEN];
+	if (!count) return;
+	#ifdef USE_VIRTUAL_PINS
+	if (port>=VPA) vpins_io_stream(port,seq,count,mark,in);
+	else
+	#endif
+	{
+		//native port, only the bus pins are touched
+		volatile uint8_t* out=openDrain?portModeRegister(port):portOutputRegister(port);
+		volatile uint8_t* pin=portInputRegister(port);
+		uint8_t k=0;
+		for(uint8_t i=0;i<count;i++) {
+			uint8_t s=openDrain?~seq[i]:seq[i];//open drain: output (low) when the bit is 0
+			uint8_t oldSREG=SREG;
+			cli();
+			*out=(*out&~mask)|(s&mask);
+			SREG=oldSREG;
+			if (delayUs) delayMicroseconds(delayUs);
+			if (mark[i>>3]&(1<<(i&7))) in[k++]=*pin;
+		}
+	}
+	for(uint8_t i=0;i<samples;i++)
+		if (in[i]&sampleMask) bits[i>>3]|=1<<(i&7);
+		else bits[i>>3]&=~(1<<(i&7));
+	count=0;
+}
+
+uint8_t PortBurst::sampleByte(uint8_t i) {
+	uint8_t v=0;
+	for(uint8_t n=0;n<8;n++) v=(v<<1)|sample(i+n);
+	return v;
+}
+
+//sets the direction of the bus pins, inputs are the ones not on mask
+static void busMode(char port,uint8_t outputs,uint8_t inputs) {
+	uint8_t oldSREG=SREG;
+	cli();
+	*portModeRegister(port)=(*portModeRegister(port)|outputs)&~inputs;
+	SREG=oldSREG;
+	#ifdef USE_VIRTUAL_PINS
+	if (port>=VPA) vpins_mode(port);
+	#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+#define VPSPI_BYTE_STATES 16//2 per bit (data with clock low, clock high)
+
+SoftSPIBus::SoftSPIBus(uint8_t sckPin,uint8_t mosiPin,int misoPin,int csPin)
+	:burst(digitalPinToPort(sckPin),0),sck(digitalPinToBitMask(sckPin)),mosi(digitalPinToBitMask(mosiPin)),miso(0),cs(0) {
+	char p=burst.port;
+	if (digitalPinToPort(mosiPin)!=p) p=NOT_A_PORT;
+	if (misoPin>=0) {
+		miso=digitalPinToBitMask(misoPin);
+		if (digitalPinToPort(misoPin)!=p) p=NOT_A_PORT;
+	}
+	if (csPin>=0) {
+		cs=digitalPinToBitMask(csPin);
+		if (digitalPinToPort(csPin)!=p) p=NOT_A_PORT;
+	}
+	burst.port=p;
+	burst.mask=sck|mosi|cs;
+	burst.sampleMask=miso;
+	level=cs;//not selected, clock low
+}
+
+void SoftSPIBus::begin() {
+	if (!ready()) return;
+	#ifdef USE_VIRTUAL_PINS
+	if (burst.port>=VPA && miso) {//quasi-bidirectional input, must be released (high) to be read
+		uint8_t oldSREG=SREG;
+		cli();
+		*portOutputRegister(burst.port)|=miso;
+		SREG=oldSREG;
+	}
+	#endif
+	busMode(burst.port,burst.mask,miso);
+	burst.put(level);
+	burst.play();
+}
+
+void SoftSPIBus::select() {
+	if (!cs) return;
+	level&=~cs;
+	burst.put(level);
+}
+
+void SoftSPIBus::deselect() {
+	if (!cs) return;
+	level|=cs;
+	burst.put(level);
+	burst.play();
+}
+
+void SoftSPIBus::play(uint8_t* in,uint8_t n) {
+	burst.play();
+	if (in)
+		for(uint8_t k=0;k<n;k++) in[k]=burst.sampleByte(k<<3);
+}
+
+void SoftSPIBus::transfer(const uint8_t* out,uint8_t* in,uint8_t n) {
+	if (!ready()) return;
+	if (!miso) in=0;
+	uint8_t first=0;//first byte of the queued burst
+	for(uint8_t i=0;i<n;i++) {
+		if (burst.room()<VPSPI_BYTE_STATES+1) {
+			play(in?in+first:0,i-first);
+			first=i;
+		}
+		uint8_t b=out?out[i]:0xFF;
+		for(uint8_t m=0x80;m;m>>=1) {
+			uint8_t s=level|(b&m?mosi:0);
+			burst.put(s);
+			burst.put(s|sck,in);//slave output is stable on the rising edge
+		}
+	}
+	burst.put(level);//clock back to idle
+	play(in?in+first:0,n-first);
+}
+
+uint8_t SoftSPIBus::transfer(uint8_t data) {
+	uint8_t r=0xFF;
+	transfer(&data,&r,1);
+	return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+#define VPI2C_BYTE_STATES 27//3 per bit, 8 bits and ack
+#define VPI2C_READ_STATES 20//2 per bit, clock low, 3 for the ack
+#define VPI2C_STOP_STATES 3
+
+SoftI2CBus::SoftI2CBus(uint8_t sdaPin,uint8_t sclPin)
+	:burst(digitalPinToPort(sdaPin),0),sda(digitalPinToBitMask(sdaPin)),scl(digitalPinToBitMask(sclPin)) {
+	if (digitalPinToPort(sclPin)!=burst.port) burst.port=NOT_A_PORT;
+	burst.mask=sda|scl;
+	burst.sampleMask=sda;
+	burst.openDrain=true;
+	burst.delayUs=4;//about 100KHz on native pins
+}
+
+void SoftI2CBus::begin() {
+	if (!ready()) return;
+	#ifdef USE_VIRTUAL_PINS
+	if (burst.port>=VPA) busMode(burst.port,burst.mask,0);//quasi-bidirectional outputs, high is released
+	else
+	#endif
+	{
+		uint8_t oldSREG=SREG;
+		cli();
+		*portOutputRegister(burst.port)&=~burst.mask;//open drain, pins only switch direction
+		SREG=oldSREG;
+	}
+	burst.put(sda|scl);
+	burst.play();
+}
+
+void SoftI2CBus::start() {
+	burst.put(sda);//clock low before releasing data (repeated start)
+	burst.put(sda|scl);
+	burst.put(scl);//data falls with clock high
+	burst.put(0);
+}
+
+void SoftI2CBus::stop() {
+	burst.put(0);
+	burst.put(scl);
+	burst.put(sda|scl);//data rises with clock high
+}
+
+void SoftI2CBus::writeBit(bool b,bool sample) {
+	uint8_t s=b?sda:0;
+	burst.put(s);
+	burst.put(s|scl,sample);
+	burst.put(s);
+}
+
+void SoftI2CBus::writeByte(uint8_t data) {
+	for(uint8_t m=0x80;m;m>>=1) writeBit(data&m);
+	writeBit(1,true);//release data, slave acks low
+}
+
+void SoftI2CBus::readByte(bool ack) {
+	for(uint8_t n=0;n<8;n++) {
+		burst.put(sda);
+		burst.put(sda|scl,true);
+	}
+	burst.put(sda);//clock falls before the ack changes data (no start/stop)
+	writeBit(!ack);
+}
+
+//error code of the first nack of n written bytes, first is the index of the first one (0 is the address)
+static uint8_t nacked(PortBurst& burst,uint8_t first,uint8_t n) {
+	for(uint8_t k=0;k<n;k++)
+		if (burst.sample(k)) return first+k?3:2;
+	return 0;
+}
+
+uint8_t SoftI2CBus::writeTo(uint8_t addr,const uint8_t* data,uint8_t n,bool sendStop) {
+	if (!ready()) return 4;
+	uint8_t err=0,first=0;//first byte of the queued burst (0 is the address)
+	start();
+	writeByte(addr<<1);
+	for(uint8_t i=1;i<=n;i++) {
+		if (burst.room()<VPI2C_BYTE_STATES+VPI2C_STOP_STATES) {
+			burst.play();
+			if ((err=nacked(burst,first,i-first))) break;
+			first=i;
+		}
+		writeByte(data[i-1]);
+	}
+	if (!err) {
+		if (sendStop) stop();
+		burst.play();
+		err=nacked(burst,first,n+1-first);
+		if (sendStop || !err) return err;
+	}
+	stop();//a nack ends the transaction
+	burst.play();
+	return err;
+}
+
+uint8_t SoftI2CBus::readFrom(uint8_t addr,uint8_t* data,uint8_t n) {
+	if (!ready() || !n) return 0;
+	uint8_t s=1,first=0;//first sample of the data (after the address ack) and first byte of the queued burst
+	start();
+	writeByte((addr<<1)|1);
+	for(uint8_t i=0;i<n;i++) {
+		if (burst.room()<VPI2C_READ_STATES+VPI2C_STOP_STATES) {
+			burst.play();
+			if (s && burst.sample(0)) {//address nack
+				stop();
+				burst.play();
+				return 0;
+			}
+			for(;first<i;first++,s+=8) data[first]=burst.sampleByte(s);
+			s=0;
+		}
+		readByte(i<n-1);//last byte is not acked
+	}
+	stop();
+	burst.play();
+	if (s && burst.sample(0)) return 0;//address nack
+	for(;first<n;first++,s+=8) data[first]=burst.sampleByte(s);
+	return n;
+}
+
+uint8_t SoftI2CBus::readRegs(uint8_t addr,uint8_t reg,uint8_t* data,uint8_t n) {
+	if (writeTo(addr,&reg,1,false)) return 0;
+	return readFrom(addr,data,n);
+}
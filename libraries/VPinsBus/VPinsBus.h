@@ -0,0 +1,74 @@
+#ifndef VPINS_BUS_DEF
+#define VPINS_BUS_DEF
+
+	#include <Arduino.h>
+
+	//bit-banged buses on one port (native or virtual)
+	//a bit-bang is a sequence of port states, on virtual ports it is queued on a PortBurst and
+	//played in one branch transfer (vpins_io_stream), input samples are taken after flagged states
+	//all pins of a bus must be on the same port
+
+	#define VPBURST_LEN 64//states per burst
+
+	class PortBurst {
+	protected:
+		uint8_t seq[VPBURST_LEN];
+		uint8_t mark[VPBURST_LEN>>3];//states followed by an input sample
+		uint8_t bits[VPBURST_LEN>>3];//sampled pin levels, in order
+		uint8_t count;//queued states
+		uint8_t samples;//queued samples (after play: samples taken)
+	public:
+		char port;
+		uint8_t mask;//bus pins, other pins of the port keep their state
+		uint8_t sampleMask;//pin read on samples
+		bool openDrain;//native ports: drive low with DDR, release high (external pull-ups)
+		uint8_t delayUs;//native ports: wait after each state (virtual ports are slow enough)
+		PortBurst(char port,uint8_t mask);
+		inline uint8_t room() {return VPBURST_LEN-count;}
+		void put(uint8_t state,bool sample=false);//state of the bus pins
+		void play();//send queued states, samples are then read with sample()
+		inline bool sample(uint8_t i) {return bits[i>>3]&(1<<(i&7));}
+		uint8_t sampleByte(uint8_t i);//8 samples from i, msb first
+	};
+
+	//SPI master, mode 0, msb first
+	//chip select (optional) rides on the same bursts
+	class SoftSPIBus {
+	protected:
+		PortBurst burst;
+		uint8_t sck,mosi,miso,cs;//pin masks (0 if not used)
+		uint8_t level;//idle state of the bus pins (chip select)
+		void play(uint8_t* in,uint8_t n);
+	public:
+		SoftSPIBus(uint8_t sckPin,uint8_t mosiPin,int misoPin=-1,int csPin=-1);
+		inline bool ready() {return burst.port!=NOT_A_PORT;}//all pins on one port
+		void begin();
+		void select();//queued with the next transfer
+		void deselect();//ends the frame, sends what is queued
+		uint8_t transfer(uint8_t data);
+		void transfer(const uint8_t* out,uint8_t* in,uint8_t n);//out or in can be null (0xFF sent, nothing read)
+	};
+
+	//I2C master, 7 bit addresses, no clock stretching
+	//pins must be open drain: quasi-bidirectional expander pins (PCF8574) or native pins (driven with DDR)
+	//and the bus needs its pull-ups
+	class SoftI2CBus {
+	protected:
+		PortBurst burst;
+		uint8_t sda,scl;//pin masks
+		void start();//also repeated start
+		void stop();
+		void writeBit(bool b,bool sample=false);
+		void writeByte(uint8_t data);//ack is sampled
+		void readByte(bool ack);//8 samples
+	public:
+		SoftI2CBus(uint8_t sdaPin,uint8_t sclPin);
+		inline bool ready() {return burst.port!=NOT_A_PORT;}//both pins on one port
+		void begin();
+		//Wire like results: 0 ok, 2 address nack, 3 data nack
+		uint8_t writeTo(uint8_t addr,const uint8_t* data,uint8_t n,bool sendStop=true);
+		uint8_t readFrom(uint8_t addr,uint8_t* data,uint8_t n);//returns bytes read (0 on address nack)
+		uint8_t readRegs(uint8_t addr,uint8_t reg,uint8_t* data,uint8_t n);//register write and repeated start read
+	};
+
+#endif
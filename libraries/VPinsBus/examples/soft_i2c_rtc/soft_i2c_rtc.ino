@@ -0,0 +1,35 @@
+/*
+Virtual pins bit-banged buses
+  a DS1307 clock on a second I2C bus made of two pins of a PCF8574 expander
+  (expander pins are quasi-bidirectional, so they work as open drain)
+  each register read is a few bursts instead of one transfer per bit
+*/
+
+#include <Wire.h>
+#include <VPinsI2C.h>
+#include <VPinsBus.h>
+
+I2CBranch i2c(Wire,0x20,VP_FREE);//PCF8574 expander
+SoftI2CBus rtcBus(i2c.pin(0),i2c.pin(1));//sda, scl (with pull-ups)
+
+#define DS1307 0x68
+
+byte bcd(byte v) {return (v>>4)*10+(v&0x0F);}
+
+void setup() {
+  Serial.begin(115200);
+  Wire.begin();
+  rtcBus.begin();
+}
+
+void loop() {
+  byte t[3];
+  if (rtcBus.readRegs(DS1307,0,t,3)==3) {
+    Serial.print(bcd(t[2]&0x3F));
+    Serial.print(':');
+    Serial.print(bcd(t[1]));
+    Serial.print(':');
+    Serial.println(bcd(t[0]&0x7F));
+  } else Serial.println("no clock");
+  delay(1000);
+}
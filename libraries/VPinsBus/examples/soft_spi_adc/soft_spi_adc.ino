@@ -0,0 +1,34 @@
+/*
+Virtual pins bit-banged buses
+  MCP3008 adc on a software SPI bus over the pins of a PCF8574 expander
+  chip select, clock and data of a conversion go out as bursts on the I2C branch
+*/
+
+#include <Wire.h>
+#include <VPinsI2C.h>
+#include <VPinsBus.h>
+
+I2CBranch i2c(Wire,0x20,VP_FREE);//PCF8574 expander
+SoftSPIBus adcBus(i2c.pin(0),i2c.pin(1),i2c.pin(2),i2c.pin(3));//sck, mosi, miso, cs
+
+int readADC(byte ch) {
+  byte out[3]={1,(byte)(0x80|(ch<<4)),0},in[3];//start bit, single ended channel
+  adcBus.select();
+  adcBus.transfer(out,in,3);
+  adcBus.deselect();
+  return ((in[1]&3)<<8)|in[2];
+}
+
+void setup() {
+  Serial.begin(115200);
+  Wire.begin();
+  adcBus.begin();
+}
+
+void loop() {
+  for(byte ch=0;ch<8;ch++) {
+    Serial.print(readADC(ch));
+    Serial.print(ch<7?' ':'\n');
+  }
+  delay(500);
+}
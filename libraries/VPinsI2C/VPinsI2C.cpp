@@ -9,8 +9,14 @@ I2CBranch::I2CBranch(TwoWire & wire,char id,char local,char sz)
 }
 
 void I2CBranch::io() {in();out();}
+bool I2CBranch::isrSafe() {return false;}
 void I2CBranch::mode() {}//TODO: see PCA9557, derive the class to support specific hardware or family
-void I2CBranch::in() {}//TODO: test i2c input shift registers... have none till now
+//quasi-bidirectional expanders (PCF8574 family) answer a read with the pin levels, one byte per port
+void I2CBranch::in() {
+	Wire.requestFrom((uint8_t)serverId,(uint8_t)size);
+	for(int n=localPort;n<localPort+size;n++)
+		*portInputRegister(n)=Wire.read();
+}
 
 void I2CBranch::out() {
   Wire.beginTransmission(serverId);
@@ -19,6 +25,51 @@ void I2CBranch::out() {
   Wire.endTransmission(serverId);
 }
 
+//expanders latch every received byte, so a sequence of states goes on one transaction
+//(split only when the Wire buffer is full)
+void I2CBranch::outStream(char port,const uint8_t* seq,char n) {
+	char used=0;
+	Wire.beginTransmission(serverId);
+	for(char i=0;i<n;i++) {
+		if (used+size>BUFFER_LENGTH) {
+			Wire.endTransmission();
+			Wire.beginTransmission(serverId);
+			used=0;
+		}
+		*portOutputRegister(port)=seq[i];
+		for(int p=localPort;p<localPort+size;p++)
+			Wire.write(*portOutputRegister(p));
+		used+=size;
+	}
+	Wire.endTransmission();
+}
+
+//states go out on one transaction, each sample closes it and reads the ports
+void I2CBranch::ioStream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in) {
+	char used=0;
+	Wire.beginTransmission(serverId);
+	for(char i=0;i<n;i++) {
+		if (used+size>BUFFER_LENGTH) {
+			Wire.endTransmission();
+			Wire.beginTransmission(serverId);
+			used=0;
+		}
+		*portOutputRegister(port)=seq[i];
+		for(int p=localPort;p<localPort+size;p++)
+			Wire.write(*portOutputRegister(p));
+		used+=size;
+		if (mark[i>>3]&(1<<(i&7))) {
+			Wire.endTransmission();
+			this->in();
+			*in++=*portInputRegister(port);
+			if (i==n-1) return;
+			Wire.beginTransmission(serverId);
+			used=0;
+		}
+	}
+	Wire.endTransmission();
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 I2CServerBranch::I2CServerBranch(TwoWire & wire,char id,char local,char host,char sz):hostPort(host),I2CBranch(wire,id,local,sz) {
 	//TODO: wait for server to be ready
@@ -43,6 +94,8 @@ void I2CServerBranch::in() {
   Wire.endTransmission(serverId);
 }
 void I2CServerBranch::out() {dispatch(0b01);}
+void I2CServerBranch::outStream(char port,const uint8_t* seq,char n) {portBranch::outStream(port,seq,n);}
+void I2CServerBranch::ioStream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in) {portBranch::ioStream(port,seq,n,mark,in);}
 
 //op is port data info (3 bytes) index, avr ports compatible
 void I2CServerBranch::dispatch(char op) {
@@ -56,4 +109,135 @@ void I2CServerBranch::dispatch(char op) {
   Wire.endTransmission(serverId);
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PCA9685 registers
+#define PCA9685_MODE1 0x00
+#define PCA9685_MODE2 0x01
+#define PCA9685_LED0 0x06
+#define PCA9685_PRESCALE 0xFE
+#define PCA9685_AI 0x20
+#define PCA9685_SLEEP 0x10
+#define PCA9685_FULL 0x10//full on/off bit on ON_H/OFF_H
+//channels per transaction, 4 bytes each + register address must fit Wire buffer
+#define PCA9685_BURST ((BUFFER_LENGTH-1)>>2)
+
+PCA9685Branch::PCA9685Branch(TwoWire & wire,char id,char local,char sz)
+	:I2CBranch(wire,id,local,sz),dirty(0),last(0),autoFlush(true) {
+	for(int n=0;n<16;n++) value[n]=0;
+}
+
+//Wire must be started
+bool PCA9685Branch::begin(int freq) {
+	//prescale=round(25MHz/(4096*freq))-1
+	long pre=((25000000L*2)/(4096L*freq)+1)/2-1;
+	if (pre<3) pre=3;
+	if (pre>255) pre=255;
+	Wire.beginTransmission(serverId);
+	Wire.write(PCA9685_MODE1);
+	Wire.write(PCA9685_AI|PCA9685_SLEEP);//prescaler can only be set while sleeping
+	if (Wire.endTransmission()) return false;
+	Wire.beginTransmission(serverId);
+	Wire.write(PCA9685_PRESCALE);
+	Wire.write((uint8_t)pre);
+	Wire.endTransmission();
+	Wire.beginTransmission(serverId);
+	Wire.write(PCA9685_MODE1);
+	Wire.write(PCA9685_AI);//wake up with register auto-increment
+	Wire.endTransmission();
+	delayMicroseconds(500);//oscillator startup
+	Wire.beginTransmission(serverId);
+	Wire.write(PCA9685_MODE2);
+	Wire.write(0x04);//totem pole outputs
+	Wire.endTransmission();
+	dirty=0xFFFF;
+	flush();
+	return true;
+}
+
+void PCA9685Branch::set(char ch,uint16_t duty) {
+	if (ch<0||ch>15) return;
+	if (duty>4096) duty=4096;
+	if (value[ch]==duty) return;
+	value[ch]=duty;
+	dirty|=1U<<ch;
+	if (autoFlush) flush();
+}
+
+//send changed channels, consecutive channels go on the same transaction
+void PCA9685Branch::flush() {
+	char ch=0;
+	while(dirty) {
+		while(!(dirty&(1U<<ch))) ch++;
+		Wire.beginTransmission(serverId);
+		Wire.write(PCA9685_LED0+(ch<<2));
+		for(char n=0;n<PCA9685_BURST && ch<16 && (dirty&(1U<<ch));n++,ch++) {
+			uint16_t v=value[ch];
+			Wire.write(0);//ON_L
+			Wire.write(v==4096?PCA9685_FULL:0);//ON_H
+			Wire.write(v&0xFF);//OFF_L
+			Wire.write(v==0?PCA9685_FULL:(v>>8)&0x0F);//OFF_H
+			dirty&=~(1U<<ch);
+		}
+		Wire.endTransmission();
+	}
+}
 
+void PCA9685Branch::outStream(char port,const uint8_t* seq,char n) {portBranch::outStream(port,seq,n);}
+void PCA9685Branch::ioStream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in) {portBranch::ioStream(port,seq,n,mark,in);}
+void PCA9685Branch::mode() {}//all channels are outputs
+void PCA9685Branch::in() {}//no inputs
+
+//digitalWrite on a channel sets full on/off, only for bits that changed
+void PCA9685Branch::out() {
+	uint16_t bits=*portOutputRegister(localPort);
+	if (size>1) bits|=((uint16_t)*portOutputRegister(localPort+1))<<8;
+	uint16_t chg=bits^last;
+	last=bits;
+	for(char ch=0;ch<16;ch++)
+		if (chg&(1U<<ch)) {
+			value[ch]=bits&(1U<<ch)?4096:0;
+			dirty|=1U<<ch;
+		}
+	if (autoFlush) flush();
+}
+
+//analogWrite 0..255 maps to 0..4095, 255 is full on
+bool PCA9685Branch::analog(char ch,int val) {
+	if (ch<0||ch>=(size<<3)) return false;
+	set(ch,val<=0?0:val>=255?4096:(val<<4)|(val>>4));
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+MCP4725Branch::MCP4725Branch(TwoWire & wire,char id,char local)
+	:I2CBranch(wire,id,local,1),value(0),dirty(false),autoFlush(true) {}
+
+void MCP4725Branch::set(uint16_t v) {
+	if (v>4095) v=4095;
+	if (value==v) return;
+	value=v;
+	dirty=true;
+	if (autoFlush) flush();
+}
+
+//fast mode write, 2 bytes, no EEPROM
+void MCP4725Branch::flush() {
+	if (!dirty) return;
+	Wire.beginTransmission(serverId);
+	Wire.write((value>>8)&0x0F);
+	Wire.write(value&0xFF);
+	Wire.endTransmission();
+	dirty=false;
+}
+
+void MCP4725Branch::outStream(char port,const uint8_t* seq,char n) {portBranch::outStream(port,seq,n);}
+void MCP4725Branch::ioStream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in) {portBranch::ioStream(port,seq,n,mark,in);}
+void MCP4725Branch::mode() {}
+void MCP4725Branch::in() {}
+void MCP4725Branch::out() {set(*portOutputRegister(localPort)&1?4095:0);}//digital on pin 0
+
+bool MCP4725Branch::analog(char ch,int val) {
+	if (ch) return false;
+	set(val<=0?0:val>=255?4095:(val<<4)|(val>>4));
+	return true;
+}
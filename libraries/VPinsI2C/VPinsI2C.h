@@ -14,6 +14,9 @@
 		virtual void in();
 		virtual void out();
 		virtual void io();
+		virtual void outStream(char port,const uint8_t* seq,char n);//all states on one transaction
+		virtual void ioStream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in);//one transaction between samples
+		virtual bool isrSafe();//Wire waits on its own interrupt
 	};
 
 	//virtual port over I2c (target can be any hardware or virtual port at server)
@@ -27,5 +30,47 @@
 		virtual void mode();
 		virtual void in();
 		virtual void out();
+		virtual void outStream(char port,const uint8_t* seq,char n);
+		virtual void ioStream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in);
+	};
+
+	//PCA9685 16 channel 12bit PWM driver (2 ports)
+	//analogWrite values are kept and only changed channels are sent
+	//on flush, as auto-increment bursts (limited by Wire buffer)
+	class PCA9685Branch:public I2CBranch {
+	protected:
+		uint16_t value[16];//12 bit duty, 4096 means full on
+		uint16_t dirty;//changed channels
+		uint16_t last;//last sent port bits (for digitalWrite)
+	public:
+		bool autoFlush;//send on every analogWrite, turn off to batch updates
+		PCA9685Branch(TwoWire & wire,char id,char local,char sz=2);
+		bool begin(int freq=1000);
+		void set(char ch,uint16_t duty);//12bit duty (0..4096)
+		void flush();
+		virtual void mode();
+		virtual void in();
+		virtual void out();
+		virtual bool analog(char ch,int val);
+		virtual void outStream(char port,const uint8_t* seq,char n);
+		virtual void ioStream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in);
+	};
+
+	//MCP4725 12bit I2C DAC (1 channel on pin 0)
+	class MCP4725Branch:public I2CBranch {
+	protected:
+		uint16_t value;
+		bool dirty;
+	public:
+		bool autoFlush;
+		MCP4725Branch(TwoWire & wire,char id,char local);
+		void set(uint16_t v);//12 bit value
+		void flush();
+		virtual void mode();
+		virtual void in();
+		virtual void out();
+		virtual bool analog(char ch,int val);
+		virtual void outStream(char port,const uint8_t* seq,char n);
+		virtual void ioStream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in);
 	};
 #endif
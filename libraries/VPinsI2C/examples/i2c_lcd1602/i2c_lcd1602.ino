@@ -17,11 +17,14 @@ void setup() {
   Serial.begin(9600);
   Wire.begin();
   lcd.begin(16, 2);
+  lcd.frameBuffer();//print goes to RAM, update() sends only what changed
   lcd.print("hello, world!");
 }
 
 void loop() {
   lcd.setCursor(0, 1);
   lcd.print(millis()%1000);
+  lcd.print("   ");
+  lcd.update(2000);//at most 2ms of bus time per loop
 }
 
@@ -0,0 +1,23 @@
+/*
+  Virtual pins I2C, PCA9685 - fade 16 leds with analogWrite
+  all changed channels are sent on one burst by flush()
+ */
+
+#include <Wire.h>
+#include <VPinsI2C.h>
+
+PCA9685Branch pwm(Wire,0x40,VPA);//16 channels on VPA and VPB
+
+void setup() {
+  Wire.begin();
+  pwm.begin(1000);//pwm frequency (Hz)
+  pwm.autoFlush=false;//batch updates
+}
+
+void loop() {
+  int t=millis()>>2;
+  for(int n=0;n<16;n++)
+    analogWrite(pwm.pin(n),(t+(n<<4))&0xFF);
+  pwm.flush();//one auto-increment burst for all changed channels
+  delay(10);
+}
@@ -0,0 +1,123 @@
+#include <Arduino.h>
+#include <virtual_pins.h>
+#include "../SPI/SPI.h"
+#include "../RF24/RF24.h"
+#include "VPinsRF24.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+RF24Branch::RF24Branch(RF24& r,uint64_t addr,char local,char host,char sz)
+	:radio(r),address(addr),hostPort(host),portBranch(local,sz>VPRF24_MAX_PORTS?VPRF24_MAX_PORTS:sz),fresh(true),ok(false) {}
+
+//radio must be started (radio.begin())
+void RF24Branch::begin() {
+	radio.enableAckPayload();
+	radio.enableDynamicPayloads();
+	radio.openWritingPipe(address);
+	radio.stopListening();
+	fresh=true;
+}
+
+char RF24Branch::changed(char op) {
+	char mask=0;
+	for(int n=0;n<size;n++)
+		if (fresh || shadow[(n<<1)+op]!=*(portModeRegister(localPort+n)+op))
+			mask|=1<<(n+(op<<2));
+	return mask;
+}
+
+//one write, inputs come back on the ack payload
+bool RF24Branch::sync(char mask) {
+	char buf[2+(VPRF24_MAX_PORTS<<1)];
+	char len=2;
+	buf[0]=(hostPort<<2)|(size-1);//port set on the header, like I2CServerBranch
+	buf[1]=mask;
+	for(int n=0;n<size;n++)
+		for(char op=0;op<2;op++)
+			if (mask&(1<<(n+(op<<2))))
+				buf[len++]=shadow[(n<<1)+op]=*(portModeRegister(localPort+n)+op);
+	ok=radio.write(buf,len);
+	fresh=!ok;//lost packet, resend full state on next sync
+	if (!ok) return false;
+	if (radio.isAckPayloadAvailable()) {
+		char in[VPRF24_MAX_PORTS];
+		radio.read(in,size);
+		for(int n=0;n<size;n++)
+			*portInputRegister(localPort+n)=in[n];
+	}
+	return true;
+}
+
+void RF24Branch::mode() {
+	char mask=changed(0);
+	if (mask) sync(mask);
+}
+
+//always exchange, this is the only way to get inputs
+void RF24Branch::in() {sync(changed(0)|changed(1));}
+
+//no change, no airtime
+void RF24Branch::out() {
+	char mask=changed(1);
+	if (mask) sync(mask);
+}
+
+void RF24Branch::io() {in();}
+bool RF24Branch::isrSafe() {return false;}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+VPortServerRF24::VPortServerRF24(RF24& r,char f,char c):radio(r),hostPort(0),size(0),first(f),count(c) {}
+
+//requested range is inside the served one and every port has registers
+bool VPortServerRF24::serves(uint8_t port,uint8_t size) {
+	if (port<first || port+size>first+count) return false;
+	for(uint8_t n=0;n<size;n++)
+		if (portModeRegister(port+n)==NOT_A_PORT) return false;
+	return true;
+}
+
+//radio must be started (radio.begin())
+void VPortServerRF24::begin(uint64_t addr) {
+	radio.enableAckPayload();
+	radio.enableDynamicPayloads();
+	radio.openReadingPipe(VPRF24_PIPE,addr);
+	radio.startListening();
+}
+
+//preload input bytes for the next exchange
+void VPortServerRF24::ack() {
+	char buf[VPRF24_MAX_PORTS];
+	for(int n=0;n<size;n++) {
+		vpins_in(hostPort+n);
+		buf[n]=*portInputRegister(hostPort+n);
+	}
+	radio.writeAckPayload(VPRF24_PIPE,buf,size);
+}
+
+//process pending packets, returns true if any
+bool VPortServerRF24::poll() {
+	bool got=false;
+	while(radio.available()) {
+		char buf[2+(VPRF24_MAX_PORTS<<1)];
+		uint8_t len=radio.getDynamicPayloadSize();
+		//reading pops the payload even if shorter, so oversized ones are dropped too
+		radio.read(buf,len<sizeof(buf)?len:sizeof(buf));
+		if (len<2 || len>sizeof(buf)) continue;
+		uint8_t port=(buf[0]>>2)&0x3F;
+		uint8_t sz=(buf[0]&0b11)+1;
+		if (!serves(port,sz)) continue;
+		char mask=buf[1];
+		uint8_t at=2;
+		size=sz;
+		hostPort=port;
+		for(int n=0;n<size;n++) {
+			for(char op=0;op<2;op++)
+				if ((mask&(1<<(n+(op<<2)))) && at<len)
+					*(portModeRegister(port+n)+op)=buf[at++];
+			if (mask&(1<<n)) vpins_mode(port+n);
+			if (mask&(1<<(n+4))) vpins_out(port+n);
+		}
+		ack();
+		got=true;
+	}
+	return got;
+}
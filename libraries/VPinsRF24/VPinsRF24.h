@@ -0,0 +1,55 @@
+#ifndef RF24_VPINS_PROTOCOL_DEF
+#define RF24_VPINS_PROTOCOL_DEF
+	#include <virtual_pins.h>
+	#include <RF24.h>
+
+	//ports per branch, mask byte has mode and output bits for 4 ports
+	#define VPRF24_MAX_PORTS 4
+	#define VPRF24_PIPE 1
+
+	//payload: [host port<<2|size-1][mask][changed bytes...]
+	//mask bit n -> mode of port n follows, bit n+4 -> output of port n follows
+	//input bytes of all ports come back on the ack payload (one round trip)
+	//ack payload is preloaded by the server, so inputs are sampled right after the previous exchange
+
+	//virtual port over nRF24L01 (target can be any hardware or virtual port at server)
+	class RF24Branch:public portBranch {
+	protected:
+		RF24& radio;
+		char shadow[VPRF24_MAX_PORTS<<1];//last sent mode/output
+		bool fresh;//send everything on next sync
+		char changed(char op);//mask of changed registers (op 0:mode 1:output)
+		bool sync(char mask);
+	public:
+		uint64_t address;
+		char hostPort;//host port nr
+		bool ok;//last exchange was acknowledged
+		RF24Branch(RF24& radio,uint64_t addr,char local,char host,char sz=1);
+		void begin();
+		virtual void mode();
+		virtual void in();
+		virtual void out();
+		virtual void io();
+		virtual bool isrSafe();//waits for the ack
+	};
+
+	//serve local ports (hardware or virtual) to a RF24Branch
+	//only ports first..first+count-1 are served, payloads reaching outside are dropped
+	//default serves the virtual ports only, native ports (the radio SPI, CE and CSN pins are there too)
+	//must be given explicitly
+	//call poll() from loop, radio has no receive callback
+	class VPortServerRF24 {
+	protected:
+		RF24& radio;
+		char hostPort;
+		char size;
+		uint8_t first;
+		uint8_t count;
+		bool serves(uint8_t port,uint8_t size);
+		void ack();
+	public:
+		VPortServerRF24(RF24& radio,char first=VPA,char count=VPINS_PORTS);
+		void begin(uint64_t addr);
+		bool poll();
+	};
+#endif
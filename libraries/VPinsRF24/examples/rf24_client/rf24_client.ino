@@ -0,0 +1,26 @@
+/*
+Virtual pins over nRF24L01
+  blink a led and read a button on a remote node
+  each sync is one radio write, inputs come back on the ack payload
+*/
+
+#include <SPI.h>
+#include <RF24.h>
+#include <VPinsRF24.h>
+
+RF24 radio(9,10);//CE,CSN
+RF24Branch remote(radio,0xF0F0F0F0E1LL,VPA,PD);//local VPA mirrors server port D
+
+void setup() {
+  Serial.begin(9600);
+  radio.begin();
+  remote.begin();
+  pinMode(remote.pin(5),OUTPUT);//led on server pin 5
+  pinMode(remote.pin(2),INPUT);//button on server pin 2
+}
+
+void loop() {
+  digitalWrite(remote.pin(5),(millis()>>9)&1);//only sent when it changes
+  Serial.println(digitalRead(remote.pin(2)));//one round trip
+  delay(100);
+}
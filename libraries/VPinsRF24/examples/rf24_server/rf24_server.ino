@@ -0,0 +1,20 @@
+/*
+Virtual pins over nRF24L01
+  serve this board ports to a RF24Branch
+*/
+
+#include <SPI.h>
+#include <RF24.h>
+#include <VPinsRF24.h>
+
+RF24 radio(9,10);//CE,CSN
+VPortServerRF24 server(radio,PD,1);//native port D, given explicitly (default is the virtual ports)
+
+void setup() {
+  radio.begin();
+  server.begin(0xF0F0F0F0E1LL);
+}
+
+void loop() {
+  server.poll();
+}
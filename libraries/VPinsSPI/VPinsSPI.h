@@ -22,5 +22,28 @@
 		virtual void in();
 		virtual void out();
 		virtual void io();
+		virtual void ioStream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in);//one io() per state
+	};
+
+	//MCP4922 dual 12bit SPI DAC (channels A,B on pins 0,1)
+	//both changed channels are sent and then latched together with LDAC
+	class MCP4922Branch:public portBranch {
+	private:
+		SPIClass& SPI;
+		uint16_t value[2];
+		char dirty;
+		char last;//last port bits (for digitalWrite)
+	public:
+		char csPin;
+		char ldacPin;//-1 if LDAC is tied low (channels update on CS rise)
+		bool autoFlush;//send on every analogWrite, turn off to batch updates
+		MCP4922Branch(SPIClass &spi,char cs_pin,char port,char ldac_pin=-1);
+		void set(char ch,uint16_t v);//12 bit value
+		void flush();
+		virtual void mode();
+		virtual void in();
+		virtual void out();
+		virtual void io();
+		virtual bool analog(char ch,int val);
 	};
 #endif
@@ -3,11 +3,9 @@
 #include "VPinsSPI.h"
 #include "../SPI/SPI.h"
 
-#define PORTREGSZ 3//why is this not defined! damn weird build!
 
 //give real pin for spi latch, virtual port number, and # of ports
 SPIBranch::SPIBranch(SPIClass &spi,char latch_pin,char port,char sz):SPI(spi),latchPin(latch_pin),portBranch(port,sz),ioMode(VPSPI_COMPAT) {
-	Serial.print("SPIBranch");
 	pinMode(latchPin,OUTPUT);
 	on(latchPin);
 	//SPI.begin();
@@ -22,35 +20,109 @@ void SPIBranch::in() {io();}//call io because SPI bus is full-duplex
 void SPIBranch::out() {io();}//call io because SPI bus is full-duplex
 
 //do input and output (SPI is a bidirectional bus)
+//last port output goes first (farthest on the chain), first byte received is the first port input
+//interrupts are held meanwhile, tone() and Servo transfer from their ISR and would cut the chain
 void SPIBranch::io() {
-	Serial.print("SPIBranch::io");
+	uint8_t oldSREG=SREG;
+	cli();
 	pulse(latchPin);//read data (will also show output data)
-	switch(ioMode) {
- 	case VPSPI_COMPAT: {
+	for(int n=size-1;n>=0;n--) {
+		char data=SPI.transfer(*portOutputRegister(localPort+n));
+		char p=localPort+size-1-n;
+		switch(ioMode) {
+		case VPSPI_COMPAT:
 			//in this mode pins can be input or output but not both at same time (still read all at once)
 			//if the pin is in output mode, reading data will read the outputed data
 			//if pin is input, setting output will do nothing unless we have an external pull resistor to the input
-			int lastPort=localPort+size-VPA-1;
-			for(int p=lastPort;p>lastPort-size;p--) {
-				vpins_data[PORTREGSZ*(size-p-1)+2]=
-					(SPI.transfer(vpins_data[PORTREGSZ*p+1]) & ~vpins_data[PORTREGSZ*(size-p-1)])
-					| (vpins_data[PORTREGSZ*(size-p-1)+1] & vpins_data[PORTREGSZ*(size-p-1)]);
-			}
+			*portInputRegister(p)=(data & ~*portModeRegister(p)) | (*portOutputRegister(p) & *portModeRegister(p));
+			break;
+		case VPSPI_DUPLEX:
+			// in this mode: separate inputs and outputs (still read all at once), only keeps data apart
+			// even with separate data and working independent (in/out) pins will have the same number
+			// digitalWrite(20,x) will affect 1st data pin of first shiftout register
+			// digitalread(20) will get data from 1st input pin of first shiftin register
+		default:
+			*portInputRegister(p)=data;
+			break;
 		}
-		break;
-	case VPSPI_DUPLEX:
-		// in this mode: separate inputs and outputs (still read all at once), only keeps data apart
-		// even with separate data and working independent (in/out) pins will have the same number
-		// digitalWrite(20,x) will affect 1st data pin of first shiftout register
-		// digitalread(20) will get data from 1st input pin of first shiftin register
-	default:
-		int lastPort=localPort+size-VPA-1;
-		for(int p=lastPort;p>lastPort-size;p--) {
-			vpins_data[PORTREGSZ*(size-p-1)+2]=SPI.transfer(vpins_data[PORTREGSZ*p+1]);
-		}
-		break;
 	}
 	pulse(latchPin);//write data
+	SREG=oldSREG;
+}
+
+//every transfer reads the inputs too, so a sampled state costs no extra transfer
+void SPIBranch::ioStream(char port,const uint8_t* seq,char n,const uint8_t* mark,uint8_t* in) {
+	for(char i=0;i<n;i++) {
+		*portOutputRegister(port)=seq[i];
+		io();
+		if (mark[i>>3]&(1<<(i&7))) *in++=*portInputRegister(port);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+#define MCP4922_B 0x8000//channel B select
+#define MCP4922_GA 0x2000//1x gain
+#define MCP4922_SHDN 0x1000//output active
+
+MCP4922Branch::MCP4922Branch(SPIClass &spi,char cs_pin,char port,char ldac_pin)
+	:SPI(spi),csPin(cs_pin),ldacPin(ldac_pin),portBranch(port,1),dirty(0),last(0),autoFlush(true) {
+	value[0]=value[1]=0;
+	pinMode(csPin,OUTPUT);
+	on(csPin);
+	if (ldacPin>=0) {
+		pinMode(ldacPin,OUTPUT);
+		on(ldacPin);
+	}
+}
+
+void MCP4922Branch::set(char ch,uint16_t v) {
+	if (ch<0||ch>1) return;
+	if (v>4095) v=4095;
+	if (value[ch]==v) return;
+	value[ch]=v;
+	dirty|=1<<ch;
+	if (autoFlush) flush();
+}
+
+void MCP4922Branch::flush() {
+	if (!dirty) return;
+	uint8_t oldSREG=SREG;
+	cli();//same as SPIBranch::io
+	for(char ch=0;ch<2;ch++)
+		if (dirty&(1<<ch)) {
+			uint16_t cmd=(ch?MCP4922_B:0)|MCP4922_GA|MCP4922_SHDN|value[ch];
+			off(csPin);
+			SPI.transfer(cmd>>8);
+			SPI.transfer(cmd&0xFF);
+			on(csPin);
+		}
+	if (ldacPin>=0) {
+		off(ldacPin);//latch both outputs at once
+		on(ldacPin);
+	}
+	dirty=0;
+	SREG=oldSREG;
 }
 
+void MCP4922Branch::mode() {}//outputs only
+void MCP4922Branch::in() {}
+void MCP4922Branch::io() {out();}
 
+//digitalWrite sets a channel full scale or zero, only for changed bits
+void MCP4922Branch::out() {
+	char bits=*portOutputRegister(localPort)&0b11;
+	char chg=bits^last;
+	last=bits;
+	for(char ch=0;ch<2;ch++)
+		if (chg&(1<<ch)) {
+			value[ch]=bits&(1<<ch)?4095:0;
+			dirty|=1<<ch;
+		}
+	if (autoFlush) flush();
+}
+
+bool MCP4922Branch::analog(char ch,int val) {
+	if (ch<0||ch>1) return false;
+	set(ch,val<=0?0:val>=255?4095:(val<<4)|(val>>4));
+	return true;
+}
@@ -10,7 +10,7 @@ Virtual pins library
 #include <LiquidCrystal.h>
 
 #define STCP 9//stcp or latch pin
-SPIBranch spi(SPI,STCP,VPA,2);//TODO: add version that finds a free port and make pin() fynctions the only methid to get a pin number
+SPIBranch spi(SPI,STCP,VP_FREE,2);//allocator picks free ports, use pin() to get pin numbers
 
 // initialize the library with the numbers of the interface pins
 //LiquidCrystal lcd(20, 21, 22, 23, 24, 25);// <-----<<< using virtual pins number! must update if changed port
@@ -21,6 +21,7 @@ void setup() {
   SPI.begin();//<<-- initialize the media
   // set up the LCD's number of columns and rows: 
   lcd.begin(16, 2);
+  lcd.frameBuffer();//keep a copy in RAM, only changed chars go to the wire
   // Print a message to the LCD.
   lcd.print("hello, world!");
 }
@@ -31,5 +32,6 @@ void loop() {
   lcd.setCursor(0, 1);
   // print the number of seconds since reset:
   lcd.print(millis()/1000);
+  lcd.update();// <-----<<< send the changes
 }
 
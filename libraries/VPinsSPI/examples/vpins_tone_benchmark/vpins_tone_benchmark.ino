@@ -0,0 +1,34 @@
+/*
+Virtual pins library
+  tone() on virtual pins - how fast each branch type can toggle a buzzer
+  every toggle is one branch transfer from the tone timer interrupt, so the
+  highest frequency depends on the media, tone() plays at most that and returns
+  the frequency it actually uses
+  I2C branches can't play tones (Wire can't run inside an interrupt), there
+  toneMaxFrequency() and tone() return 0
+*/
+
+#include <SPI.h>
+#include <VPinsSPI.h>
+
+#define STCP 9//stcp or latch pin
+SPIBranch spi(SPI,STCP,VP_FREE,1);//one 595 shift register
+
+void report(const char* name,int pin) {
+  Serial.print(name);
+  Serial.print(" max tone ");
+  Serial.print(toneMaxFrequency(pin));
+  Serial.println(" Hz");
+}
+
+void setup() {
+  Serial.begin(115200);
+  SPI.begin();
+  report("native",8);
+  report("spi",spi.pin(0));
+  Serial.print("A5 on spi buzzer plays ");
+  Serial.print(tone(spi.pin(0),880,500));
+  Serial.println(" Hz");
+}
+
+void loop() {}
@@ -0,0 +1,117 @@
+#include <Arduino.h>
+#include <virtual_pins.h>
+#include "VPinsUDP.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+UdpBranch::UdpBranch(UDP& u,IPAddress ip,char local,char host,char sz,uint16_t port)
+	:udp(u),server(ip),serverPort(port),hostPort(host),portBranch(local,sz>VPUDP_MAX_PORTS?VPUDP_MAX_PORTS:sz),
+	seq(0),timeout(20),ok(false) {}
+
+//network must be started (Ethernet.begin(...))
+void UdpBranch::begin(uint16_t localPort) {udp.begin(localPort);}
+
+//full state on every datagram
+void UdpBranch::send(char op) {
+	uint8_t buf[VPUDP_BUF_SZ];
+	seq++;
+	buf[0]=op;
+	buf[1]=seq>>8;
+	buf[2]=seq;
+	buf[3]=hostPort;
+	buf[4]=size;
+	for(int n=0;n<size;n++) {
+		buf[VPUDP_HDR+n]=*portModeRegister(localPort+n);
+		buf[VPUDP_HDR+size+n]=*portOutputRegister(localPort+n);
+	}
+	udp.beginPacket(server,serverPort);
+	udp.write(buf,VPUDP_REQ_SZ(size));
+	udp.endPacket();
+}
+
+//take pending replies, only the latest sequence updates inputs
+bool UdpBranch::receive() {
+	bool got=false;
+	while(udp.parsePacket()) {
+		uint8_t buf[VPUDP_REP_SZ(VPUDP_MAX_PORTS)];
+		int len=udp.read(buf,sizeof(buf));
+		udp.flush();
+		if (len<VPUDP_HDR || buf[0]!=VPUDP_REPLY || buf[3]!=hostPort || buf[4]!=size || len<VPUDP_REP_SZ(size)) continue;
+		uint16_t s=(buf[1]<<8)|buf[2];
+		if (s!=seq) continue;//stale reply
+		for(int n=0;n<size;n++)
+			*portInputRegister(localPort+n)=buf[VPUDP_HDR+n];
+		got=true;
+	}
+	return got;
+}
+
+void UdpBranch::poll() {receive();}
+
+void UdpBranch::mode() {send(VPUDP_WRITE);}
+void UdpBranch::out() {send(VPUDP_WRITE);}
+
+void UdpBranch::in() {
+	send(VPUDP_SYNC);
+	ok=receive();
+	if (ok || !timeout) return;
+	unsigned long start=millis();
+	while(!(ok=receive()) && millis()-start<timeout);
+}
+
+void UdpBranch::io() {in();}
+bool UdpBranch::isrSafe() {return false;}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+VPortServerUDP::VPortServerUDP(UDP& u,char f,char c):udp(u),lastSeq(0),started(false),first(f),count(c) {}
+
+//requested range is inside the served one and every port has registers
+bool VPortServerUDP::serves(uint8_t port,uint8_t size) {
+	if (!size || port<first || port+size>first+count) return false;
+	for(uint8_t n=0;n<size;n++)
+		if (portModeRegister(port+n)==NOT_A_PORT) return false;
+	return true;
+}
+
+void VPortServerUDP::begin(uint16_t port) {udp.begin(port);}
+
+//process pending datagrams, returns true if any
+bool VPortServerUDP::poll() {
+	bool got=false;
+	while(udp.parsePacket()) {
+		uint8_t buf[VPUDP_BUF_SZ];
+		int len=udp.read(buf,sizeof(buf));
+		udp.flush();
+		if (len<VPUDP_HDR || (buf[0]!=VPUDP_SYNC && buf[0]!=VPUDP_WRITE)) continue;
+		uint8_t port=buf[3];
+		uint8_t size=buf[4];
+		if (size>VPUDP_MAX_PORTS || len<VPUDP_REQ_SZ(size) || !serves(port,size)) continue;
+		uint16_t s=(buf[1]<<8)|buf[2];
+		//reordered old datagram, do not apply (state would go back in time)
+		bool fresh=!started || !VPUDP_STALE(s,lastSeq);
+		if (fresh) {
+			lastSeq=s;
+			started=true;
+			for(int n=0;n<size;n++) {
+				volatile uint8_t* ddr=portModeRegister(port+n);
+				volatile uint8_t* out=portOutputRegister(port+n);
+				uint8_t m=buf[VPUDP_HDR+n];
+				uint8_t o=buf[VPUDP_HDR+size+n];
+				//only changed ports reach the bus
+				if (*ddr!=m) {*ddr=m;vpins_mode(port+n);}
+				if (*out!=o) {*out=o;vpins_out(port+n);}
+			}
+		}
+		if (buf[0]==VPUDP_SYNC) {
+			buf[0]=VPUDP_REPLY;
+			for(int n=0;n<size;n++) {
+				vpins_in(port+n);
+				buf[VPUDP_HDR+n]=*portInputRegister(port+n);
+			}
+			udp.beginPacket(udp.remoteIP(),udp.remotePort());
+			udp.write(buf,VPUDP_REP_SZ(size));
+			udp.endPacket();
+		}
+		got=true;
+	}
+	return got;
+}
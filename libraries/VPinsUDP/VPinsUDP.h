@@ -0,0 +1,49 @@
+#ifndef UDP_VPINS_PROTOCOL_DEF
+#define UDP_VPINS_PROTOCOL_DEF
+	#include <virtual_pins.h>
+	#include <Udp.h>
+	#include "vpins_udp_proto.h"
+
+	//virtual port over UDP (target can be any hardware or virtual port at server)
+	//works with any UDP implementation (EthernetUDP, WiFiUDP)
+	class UdpBranch:public portBranch {
+	protected:
+		UDP& udp;
+		uint16_t seq;
+		void send(char op);
+		bool receive();
+	public:
+		IPAddress server;
+		uint16_t serverPort;
+		char hostPort;//host port nr
+		unsigned int timeout;//ms to wait for a reply on input, 0=use replies already arrived
+		bool ok;//last input reply arrived in time
+		UdpBranch(UDP& udp,IPAddress ip,char local,char host,char sz=1,uint16_t port=VPUDP_PORT);
+		void begin(uint16_t localPort=VPUDP_PORT);
+		void poll();//take late replies
+		virtual void mode();
+		virtual void in();
+		virtual void out();
+		virtual void io();
+		virtual bool isrSafe();//waits for replies
+	};
+
+	//serve local ports (hardware or virtual) to a UdpBranch client (one sequence is tracked)
+	//only ports first..first+count-1 are served, datagrams reaching outside are dropped
+	//default serves the virtual ports only, native ports (the Ethernet SPI and SS pins are there too)
+	//must be given explicitly, anyone on the network can write the served ports
+	//call poll() from loop
+	class VPortServerUDP {
+	protected:
+		UDP& udp;
+		uint16_t lastSeq;
+		bool started;
+		uint8_t first;
+		uint8_t count;
+		bool serves(uint8_t port,uint8_t size);
+	public:
+		VPortServerUDP(UDP& udp,char first=VPA,char count=VPINS_PORTS);
+		void begin(uint16_t port=VPUDP_PORT);
+		bool poll();
+	};
+#endif
@@ -0,0 +1,28 @@
+/*
+Virtual pins over Ethernet UDP
+  drive a remote node port as local VPA
+  outputs go as one datagram with full port state, lost ones are fixed by the next
+  test without hardware server: libraries/VPinsUDP/host/vpins_udp_host.c
+*/
+
+#include <SPI.h>
+#include <Ethernet.h>
+#include <EthernetUdp.h>
+#include <VPinsUDP.h>
+
+byte mac[]={0xDE,0xAD,0xBE,0xEF,0xFE,0xED};
+EthernetUDP udp;
+UdpBranch remote(udp,IPAddress(192,168,1,178),VPA,PD);//local VPA mirrors server port D
+
+void setup() {
+  Serial.begin(9600);
+  Ethernet.begin(mac,IPAddress(192,168,1,177));
+  remote.begin();
+  pinMode(remote.pin(5),OUTPUT);
+}
+
+void loop() {
+  digitalWrite(remote.pin(5),(millis()>>9)&1);
+  Serial.println(digitalRead(remote.pin(2)));//sync, waits remote.timeout ms at most
+  delay(100);
+}
@@ -0,0 +1,22 @@
+/*
+Virtual pins over Ethernet UDP
+  serve this board ports to UdpBranch clients
+*/
+
+#include <SPI.h>
+#include <Ethernet.h>
+#include <EthernetUdp.h>
+#include <VPinsUDP.h>
+
+byte mac[]={0xDE,0xAD,0xBE,0xEF,0xFE,0xEE};
+EthernetUDP udp;
+VPortServerUDP server(udp,PD,1);//native port D, given explicitly (default is the virtual ports)
+
+void setup() {
+  Ethernet.begin(mac,IPAddress(192,168,1,178));
+  server.begin();
+}
+
+void loop() {
+  server.poll();
+}
@@ -0,0 +1,127 @@
+/*
+Virtual pins over UDP, host side stand-in (linux)
+  lets the protocol be tested with real sockets without arduino hardware
+
+  build: cc -O2 -o vpins_udp_host vpins_udp_host.c
+
+  server: ./vpins_udp_host server [port] [drop%]
+    simulates 64 ports, inputs read back the outputs (loopback)
+    drop% randomly ignores datagrams to exercise loss repair
+  client: ./vpins_udp_host client [host] [port] [count]
+    sends count syncs with changing outputs and checks the loopback replies
+    exit status is 0 if every answered sync matched
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../vpins_udp_proto.h"
+
+#define HOST_PORTS 64
+
+static uint8_t ddr[HOST_PORTS],out[HOST_PORTS],pin[HOST_PORTS];
+
+static int open_socket(uint16_t port) {
+	int s=socket(AF_INET,SOCK_DGRAM,0);
+	if (s<0) {perror("socket");exit(1);}
+	struct sockaddr_in a;
+	memset(&a,0,sizeof(a));
+	a.sin_family=AF_INET;
+	a.sin_addr.s_addr=htonl(INADDR_ANY);
+	a.sin_port=htons(port);
+	if (bind(s,(struct sockaddr*)&a,sizeof(a))<0) {perror("bind");exit(1);}
+	return s;
+}
+
+static int server(uint16_t port,int drop) {
+	int s=open_socket(port);
+	uint16_t lastSeq=0;
+	int started=0;
+	printf("vpins udp stand-in listening on %u (drop %d%%)\n",port,drop);
+	for(;;) {
+		uint8_t buf[VPUDP_BUF_SZ];
+		struct sockaddr_in from;
+		socklen_t fl=sizeof(from);
+		int len=recvfrom(s,buf,sizeof(buf),0,(struct sockaddr*)&from,&fl);
+		if (len<VPUDP_HDR || (buf[0]!=VPUDP_SYNC && buf[0]!=VPUDP_WRITE)) continue;
+		if (drop && rand()%100<drop) continue;
+		uint8_t port0=buf[3],size=buf[4];
+		if (size>VPUDP_MAX_PORTS || len<VPUDP_REQ_SZ(size) || port0+size>HOST_PORTS) continue;
+		uint16_t seq=(buf[1]<<8)|buf[2];
+		if (!started || !VPUDP_STALE(seq,lastSeq)) {
+			lastSeq=seq;
+			started=1;
+			for(int n=0;n<size;n++) {
+				int p=port0+n;
+				uint8_t m=buf[VPUDP_HDR+n],o=buf[VPUDP_HDR+size+n];
+				if (ddr[p]!=m || out[p]!=o) printf("port %d mode %02X out %02X\n",p,m,o);
+				ddr[p]=m;
+				out[p]=o;
+				pin[p]=out[p];//loopback
+			}
+		}
+		if (buf[0]!=VPUDP_SYNC) continue;
+		buf[0]=VPUDP_REPLY;
+		for(int n=0;n<size;n++) buf[VPUDP_HDR+n]=pin[port0+n];
+		sendto(s,buf,VPUDP_REP_SZ(size),0,(struct sockaddr*)&from,fl);
+	}
+	return 0;
+}
+
+static int client(const char* host,uint16_t port,int count) {
+	int s=open_socket(0);
+	struct timeval tv={0,50000};//50ms, like a lan round trip budget
+	setsockopt(s,SOL_SOCKET,SO_RCVTIMEO,&tv,sizeof(tv));
+	struct sockaddr_in to;
+	memset(&to,0,sizeof(to));
+	to.sin_family=AF_INET;
+	to.sin_port=htons(port);
+	inet_pton(AF_INET,host,&to.sin_addr);
+	const uint8_t size=2,port0=13;
+	uint16_t seq=0;
+	int answered=0,bad=0;
+	for(int i=0;i<count;i++) {
+		uint8_t buf[VPUDP_BUF_SZ];
+		seq++;
+		buf[0]=VPUDP_SYNC;
+		buf[1]=seq>>8;
+		buf[2]=seq;
+		buf[3]=port0;
+		buf[4]=size;
+		for(int n=0;n<size;n++) {
+			buf[VPUDP_HDR+n]=0xFF;
+			buf[VPUDP_HDR+size+n]=(uint8_t)(i*7+n);
+		}
+		sendto(s,buf,VPUDP_REQ_SZ(size),0,(struct sockaddr*)&to,sizeof(to));
+		for(;;) {
+			uint8_t rep[VPUDP_BUF_SZ];
+			int len=recv(s,rep,sizeof(rep),0);
+			if (len<0) break;//lost, next sync repairs it
+			if (len<VPUDP_REP_SZ(size) || rep[0]!=VPUDP_REPLY) continue;
+			if (((rep[1]<<8)|rep[2])!=seq) continue;//stale reply
+			answered++;
+			for(int n=0;n<size;n++)
+				if (rep[VPUDP_HDR+n]!=(uint8_t)(i*7+n)) bad++;
+			break;
+		}
+	}
+	printf("%d syncs, %d answered, %d mismatches\n",count,answered,bad);
+	close(s);
+	return bad||!answered;
+}
+
+int main(int argc,char** argv) {
+	srand(time(0));
+	if (argc>1 && !strcmp(argv[1],"server"))
+		return server(argc>2?atoi(argv[2]):VPUDP_PORT,argc>3?atoi(argv[3]):0);
+	if (argc>1 && !strcmp(argv[1],"client"))
+		return client(argc>2?argv[2]:"127.0.0.1",argc>3?atoi(argv[3]):VPUDP_PORT,argc>4?atoi(argv[4]):100);
+	fprintf(stderr,"usage: %s server [port] [drop%%] | client [host] [port] [count]\n",argv[0]);
+	return 2;
+}
@@ -0,0 +1,30 @@
+/*
+Virtual pins over UDP, datagram layout
+shared by the arduino library and the host stand-in server (plain C, no arduino includes)
+
+request:  [magic][seq hi][seq lo][host port][size][mode x size][output x size]
+reply:    [magic][seq hi][seq lo][host port][size][input x size]
+
+every request carries the full port state, so it is idempotent
+a lost datagram is repaired by the next one, there is no retransmission
+replies echo the request sequence, stale ones are dropped by the client
+*/
+#ifndef VPINS_UDP_PROTO_DEF
+#define VPINS_UDP_PROTO_DEF
+
+	#define VPUDP_SYNC 'V'//set state and reply with inputs
+	#define VPUDP_WRITE 'W'//set state, no reply
+	#define VPUDP_REPLY 'v'
+
+	#define VPUDP_MAX_PORTS 8
+	#define VPUDP_HDR 5
+	#define VPUDP_REQ_SZ(n) (VPUDP_HDR+((n)<<1))
+	#define VPUDP_REP_SZ(n) (VPUDP_HDR+(n))
+	#define VPUDP_BUF_SZ VPUDP_REQ_SZ(VPUDP_MAX_PORTS)
+
+	#define VPUDP_PORT 8888//default udp port
+
+	//sequence a is a reordered (older) copy of b, bigger gaps mean the client restarted
+	#define VPUDP_WINDOW 64
+	#define VPUDP_STALE(a,b) ((uint16_t)((uint16_t)(b)-(uint16_t)(a)-1u)<VPUDP_WINDOW-1u)
+#endif